@@ -0,0 +1,107 @@
+#include <cstdint>
+#include <cstdlib>
+
+#include <array>
+#include <iostream>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/chrono.hpp>
+
+#include "udt/connected_protocol/io/buffers.h"
+
+namespace io = connected_protocol::io;
+
+typedef boost::chrono::high_resolution_clock Clock;
+// MTU 1500 minus IP/UDP headers and the UDT data header
+typedef std::array<uint8_t, 1456> Packet;
+
+std::size_t ByteLoopPacketize(const io::fixed_const_buffer_sequence& buffers,
+                              std::vector<Packet>* p_packets);
+std::size_t ChunkedPacketize(const io::fixed_const_buffer_sequence& buffers,
+                             std::vector<Packet>* p_packets);
+void DisplayThroughput(const char* name, std::size_t bytes,
+                       Clock::duration elapsed);
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cout << "packetization_benchmark [write_size] [iterations]"
+              << std::endl;
+    return 0;
+  }
+
+  int write_size = atoi(argv[1]);
+  int iterations = atoi(argv[2]);
+
+  // The sample client writes 100 KB buffers
+  if (write_size < 1) write_size = 100000;
+  if (iterations < 1) iterations = 1000;
+
+  std::vector<uint8_t> user_data(write_size);
+  for (std::size_t i = 0; i < user_data.size(); ++i) {
+    user_data[i] = static_cast<uint8_t>(i);
+  }
+  io::fixed_const_buffer_sequence buffers(boost::asio::buffer(user_data));
+  std::vector<Packet> packets(write_size / Packet().size() + 1);
+
+  std::size_t bytes(0);
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    bytes += ByteLoopPacketize(buffers, &packets);
+  }
+  DisplayThroughput("Byte loop", bytes, Clock::now() - start);
+
+  bytes = 0;
+  start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    bytes += ChunkedPacketize(buffers, &packets);
+  }
+  DisplayThroughput("Chunked memcpy", bytes, Clock::now() - start);
+
+  return 0;
+}
+
+/// Previous sender copy, two buffers_iterator incremented per byte
+std::size_t ByteLoopPacketize(const io::fixed_const_buffer_sequence& buffers,
+                              std::vector<Packet>* p_packets) {
+  std::size_t total_copy(0);
+  auto user_buf_current_it = boost::asio::buffers_begin(buffers);
+  auto user_buf_end_it = boost::asio::buffers_end(buffers);
+
+  for (auto& packet : *p_packets) {
+    io::fixed_mutable_buffer_sequence payload_buf(boost::asio::buffer(packet));
+    auto current_payload_it = boost::asio::buffers_begin(payload_buf);
+    auto end_payload_it = boost::asio::buffers_end(payload_buf);
+    while ((user_buf_current_it != user_buf_end_it) &&
+           (current_payload_it != end_payload_it)) {
+      *current_payload_it = *user_buf_current_it;
+
+      ++total_copy;
+      ++current_payload_it;
+      ++user_buf_current_it;
+    }
+  }
+
+  return total_copy;
+}
+
+std::size_t ChunkedPacketize(const io::fixed_const_buffer_sequence& buffers,
+                             std::vector<Packet>* p_packets) {
+  std::size_t total_copy(0);
+  io::BufferSequenceReader<io::fixed_const_buffer_sequence> reader(buffers);
+
+  for (auto& packet : *p_packets) {
+    total_copy += reader.Read(packet.data(), packet.size());
+  }
+
+  return total_copy;
+}
+
+void DisplayThroughput(const char* name, std::size_t bytes,
+                       Clock::duration elapsed) {
+  double seconds =
+      boost::chrono::duration_cast<boost::chrono::duration<double>>(elapsed)
+          .count();
+  std::cout << name << " : " << bytes / seconds / 1e9 << " GB/s" << std::endl;
+}
@@ -122,17 +122,50 @@ void TestMultipleConnections(
   threads.join_all();
 }
 
+/// Set the send options of a stream test socket, defaults are left unset
+template <class StreamProtocol>
+void SetSendOptions(typename StreamProtocol::socket& socket, bool send_copy,
+                    uint32_t send_weight, bool send_priority) {
+  typedef typename StreamProtocol::protocol_type protocol_type;
+  boost::system::error_code option_ec;
+  if (send_copy) {
+    socket.set_option(typename protocol_type::send_copy_option_type(true),
+                      option_ec);
+    ASSERT_EQ(0, option_ec.value())
+        << "Send copy option should be set: " << option_ec.message();
+  }
+
+  if (send_weight != 1) {
+    socket.set_option(
+        typename protocol_type::send_weight_option_type(send_weight),
+        option_ec);
+    ASSERT_EQ(0, option_ec.value())
+        << "Send weight option should be set: " << option_ec.message();
+  }
+
+  if (send_priority) {
+    socket.set_option(typename protocol_type::send_priority_option_type(true),
+                      option_ec);
+    ASSERT_EQ(0, option_ec.value())
+        << "Send priority option should be set: " << option_ec.message();
+  }
+}
+
 /// Test a stream protocol
 /// Bind an acceptor to the endpoint defined by
 ///   acceptor_parameters
 /// Connect a client socket to an endpoint defined
 ///   by client_parameters
 /// Send data in ping pong mode
+/// @param send_copy Both sockets copy written data into packets
+/// @param send_weight Fair queueing weight of both sockets
+/// @param send_priority Both sockets are in the strict priority class
 template <class StreamProtocol>
 void TestStreamProtocol(
     const typename StreamProtocol::resolver::query& client_query,
     const typename StreamProtocol::resolver::query& acceptor_query,
-    uint64_t max_packets) {
+    uint64_t max_packets, bool send_copy = false, uint32_t send_weight = 1,
+    bool send_priority = false) {
   std::cout << ">>>> Stream Test" << std::endl;
   typedef std::array<uint8_t, 165400> Buffer;
   typedef std::array<uint8_t, 82700> HalfBuffer;
@@ -193,6 +226,9 @@ void TestStreamProtocol(
     ASSERT_EQ(0, endpoint_ec.value())
         << "Remote endpoint should be set: " << endpoint_ec.message();
 
+    SetSendOptions<StreamProtocol>(socket2, send_copy, send_weight,
+                                   send_priority);
+
     boost::asio::async_read(socket2, boost::asio::buffer(r_buffer2),
                             received_handler2);
   };
@@ -211,6 +247,9 @@ void TestStreamProtocol(
     ASSERT_EQ(0, endpoint_ec.value())
         << "Remote endpoint should be set: " << endpoint_ec.message();
 
+    SetSendOptions<StreamProtocol>(socket1, send_copy, send_weight,
+                                   send_priority);
+
     boost::asio::async_write(socket1, boost::asio::buffer(buffer1),
                              sent_handler1);
   };
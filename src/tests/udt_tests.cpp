@@ -2,6 +2,10 @@
 
 #include <boost/thread.hpp>
 #include <chrono>
+#include <future>
+#include <memory>
+#include <set>
+#include <vector>
 
 #include <boost/asio/basic_waitable_timer.hpp>
 #include <boost/asio/buffered_write_stream.hpp>
@@ -17,11 +21,40 @@
 #include "tests/protocol_helpers.h"
 #include "tests/endpoint_helpers.h"
 
+#include "udt/connected_protocol/common/sequence_interval_set.h"
+#include "udt/connected_protocol/common/sequence_ring.h"
+#include "udt/connected_protocol/common/session_table.h"
+#include "udt/connected_protocol/common/timing_wheel.h"
+#include "udt/connected_protocol/io/free_list_pool.h"
 #include "udt/connected_protocol/protocol.h"
 #include "udt/ip/udt.h"
 
 typedef ip::udt<> udt_protocol;
 
+/// Multiplexer options set by a test, restored when it ends or fails
+class ScopedMultiplexerOptions {
+ public:
+  ScopedMultiplexerOptions()
+      : default_options_(
+            udt_protocol::protocol_type::multiplexers_manager_.options()) {}
+
+  ~ScopedMultiplexerOptions() {
+    udt_protocol::protocol_type::multiplexers_manager_.set_options(
+        default_options_);
+  }
+
+  const connected_protocol::MultiplexerOptions& default_options() const {
+    return default_options_;
+  }
+
+  void Set(const connected_protocol::MultiplexerOptions& options) {
+    udt_protocol::protocol_type::multiplexers_manager_.set_options(options);
+  }
+
+ private:
+  connected_protocol::MultiplexerOptions default_options_;
+};
+
 TEST(UDTTest, AsioProtocolTests) {
   TestAsioProtocol<udt_protocol>();
 }
@@ -49,6 +82,718 @@ TEST(UDTTest, UDTProtocolTest) {
   TestStreamProtocolSpawn<udt_protocol>(client_udt_query, acceptor_udt_query);
 }
 
+TEST(UDTTest, UDTProtocolTestSendCopy) {
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10,
+                                   true);
+}
+
+TEST(UDTTest, UDTProtocolTestReceiveBatch) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.receive_batch_size = 64;
+  options.send_batch_size = 1;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestSendBatch) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.receive_batch_size = 1;
+  options.send_batch_size = 64;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestGso) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.send_batch_size = 64;
+  options.gso_enabled = true;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestGro) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.gro_enabled = true;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestReuseportShards) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.reuseport_shards = 2;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTTestReuseportSteering) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.reuseport_shards = 4;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestMultipleConnections<udt_protocol>(client_udt_query, acceptor_udt_query,
+                                        20);
+}
+
+TEST(UDTTest, UDTProtocolTestReceiveSlots) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.receive_batch_size = 1;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestIoUring) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.io_uring_enabled = true;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestIoUringGro) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.io_uring_enabled = true;
+  options.gro_enabled = true;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestReceiveTimestamps) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.receive_timestamps_enabled = true;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestTimerPacing) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.pacing_spin_time = 0;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestTxTime) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.send_batch_size = 64;
+  options.tx_time_enabled = true;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestSendWeight) {
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10,
+                                   false, 4);
+}
+
+TEST(UDTTest, UDTProtocolTestSendPriority) {
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10,
+                                   false, 1, true);
+}
+
+TEST(UDTTest, UDTProtocolTestSharedCongestion) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.shared_congestion_enabled = true;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10,
+                                   false, 2);
+}
+
+TEST(UDTTest, UDTTestTimerThreads) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.timer_threads = 4;
+  options.reuseport_shards = 4;
+  scoped_options.Set(options);
+
+  {
+    // Multiplexers take the pool threads in turn, even when an earlier test
+    // created the timer pool with fewer threads
+    boost::asio::io_service io_service;
+    boost::asio::ip::udp::endpoint shards_endpoint(
+        boost::asio::ip::address_v4::loopback(), 9001);
+    auto& multiplexers_manager =
+        udt_protocol::protocol_type::multiplexers_manager_;
+    boost::system::error_code ec;
+    auto shards = multiplexers_manager.CreateMultiplexerShards(
+        io_service, shards_endpoint, ec);
+    ASSERT_EQ(0, ec.value()) << "Shards should be created: " << ec.message();
+    ASSERT_EQ(4u, shards.size());
+
+    std::set<boost::thread::id> thread_ids;
+    for (auto& p_shard : shards) {
+      std::promise<boost::thread::id> thread_id;
+      p_shard->get_timer_io_service().post([&thread_id]() {
+        thread_id.set_value(boost::this_thread::get_id());
+      });
+      thread_ids.insert(thread_id.get_future().get());
+    }
+    EXPECT_EQ(4u, thread_ids.size());
+
+    for (uint32_t shard = 0; shard < shards.size(); ++shard) {
+      multiplexers_manager.CleanMultiplexer(shards_endpoint, shard);
+    }
+  }
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTTestClientMultiplexers) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.client_multiplexers = 2;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestMultipleConnections<udt_protocol>(client_udt_query, acceptor_udt_query,
+                                        20);
+}
+
+TEST(UDTTest, UDTProtocolTestSerializedSessions) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.serialized_sessions = true;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTProtocolTestSerializedSessionsBatch) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.serialized_sessions = true;
+  options.receive_batch_size = 16;
+  scoped_options.Set(options);
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestStreamProtocol<udt_protocol>(client_udt_query, acceptor_udt_query, 10);
+}
+
+TEST(UDTTest, UDTTestThreadPerCore) {
+  ScopedMultiplexerOptions scoped_options;
+  connected_protocol::MultiplexerOptions options(
+      scoped_options.default_options());
+  options.reuseport_shards = 2;
+  options.thread_per_core = true;
+  options.serialized_sessions = true;
+  scoped_options.Set(options);
+
+  {
+    // Shards run on distinct threads, even when an earlier test created the
+    // timer pool with fewer threads
+    boost::asio::io_service io_service;
+    boost::asio::ip::udp::endpoint shards_endpoint(
+        boost::asio::ip::address_v4::loopback(), 9001);
+    auto& multiplexers_manager =
+        udt_protocol::protocol_type::multiplexers_manager_;
+    boost::system::error_code ec;
+    auto shards = multiplexers_manager.CreateMultiplexerShards(
+        io_service, shards_endpoint, ec);
+    ASSERT_EQ(0, ec.value()) << "Shards should be created: " << ec.message();
+    ASSERT_EQ(2u, shards.size());
+
+    std::vector<boost::thread::id> thread_ids;
+    for (auto& p_shard : shards) {
+      std::promise<boost::thread::id> thread_id;
+      p_shard->get_timer_io_service().post([&thread_id]() {
+        thread_id.set_value(boost::this_thread::get_id());
+      });
+      thread_ids.push_back(thread_id.get_future().get());
+    }
+    EXPECT_NE(thread_ids[0], thread_ids[1]);
+
+    for (uint32_t shard = 0; shard < shards.size(); ++shard) {
+      multiplexers_manager.CleanMultiplexer(shards_endpoint, shard);
+    }
+  }
+
+  udt_protocol::resolver::query acceptor_udt_query(boost::asio::ip::udp::v4(), "9000");
+  udt_protocol::resolver::query client_udt_query("127.0.0.1", "9000");
+
+  TestMultipleConnections<udt_protocol>(client_udt_query, acceptor_udt_query,
+                                        20);
+}
+
+TEST(UDTTest, DataViewCoalescedSegments) {
+  typedef udt_protocol::protocol_type::DataDatagram DataDatagram;
+  typedef udt_protocol::protocol_type::DataView DataView;
+  const std::size_t header_size(DataDatagram::Header::size);
+  const std::size_t segment_size(header_size + 8);
+
+  // Two datagrams coalesced in one slot, the second one shorter
+  std::vector<uint8_t> slot(2 * segment_size - 3);
+  for (std::size_t i = 0; i < slot.size(); ++i) {
+    slot[i] = static_cast<uint8_t>(i);
+  }
+  std::vector<uint8_t> header(header_size, 0);
+  header[3] = 42;
+  std::copy(header.begin(), header.end(), slot.begin() + segment_size);
+
+  connected_protocol::io::datagram_const_buffers buffers;
+  buffers.push_back(boost::asio::buffer(slot));
+  DataView second(
+      connected_protocol::io::SliceBuffers<
+          connected_protocol::io::datagram_const_buffers>(
+          buffers, segment_size, slot.size() - segment_size),
+      slot.size() - segment_size);
+
+  EXPECT_EQ(42u, second.header().packet_sequence_number());
+  EXPECT_EQ(5u, second.payload_size());
+  // The payload is a view on the slot
+  const uint8_t* p_payload(
+      boost::asio::buffer_cast<const uint8_t*>(*second.payload().begin()));
+  EXPECT_EQ(&slot[segment_size + header_size], p_payload);
+
+  DataDatagram datagram;
+  second.CopyTo(&datagram);
+  EXPECT_EQ(42u, datagram.header().packet_sequence_number());
+  EXPECT_EQ(5u, datagram.payload().GetSize());
+  std::vector<uint8_t> payload(5);
+  boost::asio::buffer_copy(boost::asio::buffer(payload),
+                           datagram.payload().GetConstBuffers());
+  for (std::size_t i = 0; i < payload.size(); ++i) {
+    EXPECT_EQ(slot[segment_size + header_size + i], payload[i]);
+  }
+}
+
+TEST(UDTTest, AckViewDecodesInPlace) {
+  typedef udt_protocol::protocol_type::AckDatagram AckDatagram;
+  typedef udt_protocol::protocol_type::ControlView ControlView;
+  typedef udt_protocol::protocol_type::AckView AckView;
+
+  AckDatagram ack_datagram;
+  ack_datagram.header().set_flags(AckDatagram::Header::ACK);
+  ack_datagram.header().set_additional_info(7);
+  ack_datagram.payload().set_max_packet_sequence_number(1000);
+  ack_datagram.payload().set_rtt(250);
+  ack_datagram.payload().set_rtt_var(50);
+  ack_datagram.payload().set_available_buffer_size(8192);
+  ack_datagram.payload().set_packet_arrival_speed(300);
+  ack_datagram.payload().set_estimated_link_capacity(400);
+  ack_datagram.payload().SetAsFullAck();
+
+  // Received bytes are contiguous
+  auto buffers = ack_datagram.GetConstBuffers();
+  std::vector<uint8_t> received(boost::asio::buffer_size(buffers));
+  boost::asio::buffer_copy(boost::asio::buffer(received), buffers);
+
+  ControlView control_view(
+      boost::asio::const_buffers_1(boost::asio::buffer(received)),
+      received.size());
+  ASSERT_TRUE(control_view.IsValid());
+  EXPECT_TRUE(control_view.header().IsType(AckDatagram::Header::ACK));
+  EXPECT_EQ(7u, control_view.header().additional_info());
+
+  AckView ack_view(control_view);
+  EXPECT_FALSE(ack_view.payload().IsLightAck());
+  EXPECT_EQ(1000u, ack_view.payload().max_packet_sequence_number());
+  EXPECT_EQ(250u, ack_view.payload().rtt());
+  EXPECT_EQ(50u, ack_view.payload().rtt_var());
+  EXPECT_EQ(8192u, ack_view.payload().available_buffer_size());
+  EXPECT_EQ(300u, ack_view.payload().packet_arrival_speed());
+  EXPECT_EQ(400u, ack_view.payload().estimated_link_capacity());
+
+  // A light ACK only carries the sequence number
+  ack_datagram.payload().SetAsLightAck();
+  auto light_buffers = ack_datagram.GetConstBuffers();
+  received.resize(boost::asio::buffer_size(light_buffers));
+  boost::asio::buffer_copy(boost::asio::buffer(received), light_buffers);
+  AckView light_view(ControlView(
+      boost::asio::const_buffers_1(boost::asio::buffer(received)),
+      received.size()));
+  EXPECT_TRUE(light_view.payload().IsLightAck());
+  EXPECT_EQ(1000u, light_view.payload().max_packet_sequence_number());
+  EXPECT_EQ(0u, light_view.payload().rtt());
+}
+
+TEST(UDTTest, SendPayloadReferencesBuffers) {
+  typedef udt_protocol::protocol_type::SendDatagram::Payload SendPayload;
+  std::vector<uint8_t> data(4 * 100);
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i);
+  }
+
+  SendPayload payload;
+  for (std::size_t i = 0; i < SendPayload::MAX_BUFFERS; ++i) {
+    EXPECT_TRUE(
+        payload.AddConstBuffer(boost::asio::buffer(&data[i * 100], 100)));
+  }
+  // A packet gathers at most MAX_BUFFERS caller buffers
+  EXPECT_FALSE(payload.AddConstBuffer(boost::asio::buffer(&data[300], 100)));
+  EXPECT_TRUE(payload.IsFull());
+  EXPECT_EQ(300u, payload.GetSize());
+
+  // The buffers are the caller ones, nothing is copied
+  auto buffers = payload.GetConstBuffers();
+  std::size_t index(0);
+  for (const auto& buffer : buffers) {
+    EXPECT_EQ(&data[index * 100],
+              boost::asio::buffer_cast<const uint8_t*>(buffer));
+    ++index;
+  }
+  EXPECT_EQ(static_cast<std::size_t>(SendPayload::MAX_BUFFERS), index);
+
+  // Once reset, the payload references new buffers
+  payload.Reset();
+  EXPECT_EQ(0u, payload.GetSize());
+  EXPECT_TRUE(payload.AddConstBuffer(boost::asio::buffer(&data[300], 100)));
+  EXPECT_EQ(100u, payload.GetSize());
+}
+
+TEST(UDTTest, FreeListPoolGrowth) {
+  struct Object {
+    int value;
+  };
+  connected_protocol::io::FreeListPool<Object> pool(2);
+
+  Object* p_first = pool.Acquire();
+  Object* p_second = pool.Acquire();
+  EXPECT_NE(p_first, p_second);
+  EXPECT_EQ(0u, pool.exhausted_count());
+
+  // Exhausted : a chunk as large as the pool is added
+  Object* p_third = pool.Acquire();
+  EXPECT_NE(p_first, p_third);
+  EXPECT_NE(p_second, p_third);
+  EXPECT_EQ(1u, pool.exhausted_count());
+  Object* p_fourth = pool.Acquire();
+  EXPECT_NE(p_third, p_fourth);
+  EXPECT_EQ(1u, pool.exhausted_count());
+
+  // Released from another thread
+  boost::thread releaser([&]() {
+    pool.Release(p_first);
+    pool.Release(p_second);
+  });
+  releaser.join();
+  pool.Release(p_third);
+  pool.Release(p_fourth);
+
+  std::set<Object*> acquired;
+  for (int i = 0; i < 4; ++i) {
+    acquired.insert(pool.Acquire());
+  }
+  EXPECT_EQ(4u, acquired.size());
+  EXPECT_EQ(1u, acquired.count(p_first));
+  EXPECT_EQ(1u, acquired.count(p_fourth));
+  EXPECT_EQ(1u, pool.exhausted_count());
+
+  pool.Acquire();
+  EXPECT_EQ(2u, pool.exhausted_count());
+  pool.reset_exhausted_count();
+  EXPECT_EQ(0u, pool.exhausted_count());
+}
+
+TEST(UDTTest, SequenceRingWraparound) {
+  typedef connected_protocol::common::SequenceRing<std::unique_ptr<uint32_t>>
+      Ring;
+  Ring ring(0x7FFFFFFF, 4);
+
+  // Window 0x7FFFFFFD .. 2 wraps around and outgrows the initial capacity
+  uint32_t seq(0x7FFFFFFD);
+  for (int i = 0; i < 6; ++i, seq = ring.Inc(seq)) {
+    EXPECT_TRUE(ring.Insert(seq, std::unique_ptr<uint32_t>(new uint32_t(seq))));
+  }
+  EXPECT_EQ(3u, seq);
+  EXPECT_EQ(6u, ring.size());
+  EXPECT_EQ(6u, ring.span());
+  EXPECT_EQ(0x7FFFFFFDu, ring.first_sequence());
+
+  seq = 0x7FFFFFFD;
+  for (int i = 0; i < 6; ++i, seq = ring.Inc(seq)) {
+    std::unique_ptr<uint32_t>* p_value(ring.Find(seq));
+    ASSERT_TRUE(p_value != nullptr);
+    EXPECT_EQ(seq, **p_value);
+  }
+  EXPECT_TRUE(ring.Find(3) == nullptr);
+  EXPECT_TRUE(ring.Find(0x7FFFFFFC) == nullptr);
+
+  // Before the window
+  EXPECT_FALSE(ring.Insert(0x7FFFFFFC, std::unique_ptr<uint32_t>(
+                                           new uint32_t(0x7FFFFFFC))));
+
+  // Out of order erase leaves a hole, erasing the first value skips it
+  ring.Erase(0x7FFFFFFE);
+  EXPECT_TRUE(ring.Find(0x7FFFFFFE) == nullptr);
+  EXPECT_EQ(0x7FFFFFFDu, ring.first_sequence());
+  ring.Erase(0x7FFFFFFD);
+  EXPECT_EQ(0x7FFFFFFFu, ring.first_sequence());
+  EXPECT_EQ(4u, ring.span());
+  ring.Erase(0x7FFFFFFF);
+  EXPECT_EQ(0u, ring.first_sequence());
+  EXPECT_EQ(3u, ring.size());
+
+  ring.Erase(0);
+  ring.Erase(1);
+  ring.Erase(2);
+  EXPECT_TRUE(ring.empty());
+  EXPECT_EQ(0u, ring.span());
+}
+
+TEST(UDTTest, SequenceIntervalSetMergeSplit) {
+  typedef connected_protocol::common::SequenceIntervalSet IntervalSet;
+  connected_protocol::SequenceGenerator seq_gen(0x7FFFFFFF);
+  IntervalSet set(seq_gen);
+
+  // Adjacent and overlapping inserts merge
+  set.Insert(10, 12);
+  set.Insert(13);
+  set.Insert(20, 25);
+  EXPECT_EQ(2u, set.intervals_count());
+  IntervalSet::Interval interval(set.Insert(11, 21));
+  EXPECT_EQ(10u, interval.first);
+  EXPECT_EQ(25u, interval.last);
+  EXPECT_EQ(1u, set.intervals_count());
+
+  // Erase in the middle splits
+  set.Erase(15);
+  EXPECT_EQ(2u, set.intervals_count());
+  EXPECT_EQ(14u, set.begin()->second);
+  EXPECT_EQ(16u, std::next(set.begin())->first);
+
+  // EraseBefore cuts the interval it falls in
+  set.EraseBefore(18);
+  EXPECT_EQ(1u, set.intervals_count());
+  EXPECT_EQ(18u, set.Front());
+
+  EXPECT_EQ(18u, set.PopFront());
+  EXPECT_EQ(19u, set.PopFront());
+  EXPECT_EQ(20u, set.Front());
+  EXPECT_EQ(1u, set.intervals_count());
+
+  set.EraseBefore(26);
+  EXPECT_TRUE(set.empty());
+}
+
+TEST(UDTTest, SequenceIntervalSetWraparound) {
+  typedef connected_protocol::common::SequenceIntervalSet IntervalSet;
+  connected_protocol::SequenceGenerator seq_gen(0x7FFFFFFF);
+  IntervalSet set(seq_gen);
+
+  set.Insert(2, 4);
+  set.Insert(0x7FFFFFFD, 0x7FFFFFFF);
+  EXPECT_EQ(2u, set.intervals_count());
+  EXPECT_EQ(0x7FFFFFFDu, set.Front());
+
+  // 0 joins both sides of the wrap
+  set.Insert(0, 1);
+  EXPECT_EQ(1u, set.intervals_count());
+  EXPECT_EQ(0x7FFFFFFDu, set.begin()->first);
+  EXPECT_EQ(4u, set.begin()->second);
+
+  set.Erase(0);
+  EXPECT_EQ(2u, set.intervals_count());
+  EXPECT_EQ(0x7FFFFFFFu, set.begin()->second);
+
+  set.EraseBefore(0x7FFFFFFF);
+  EXPECT_EQ(0x7FFFFFFFu, set.PopFront());
+  EXPECT_EQ(1u, set.PopFront());
+  EXPECT_EQ(2u, set.Front());
+}
+
+TEST(UDTTest, NAckRangeIncludesLastSequence) {
+  typedef udt_protocol::protocol_type::NAckDatagram NAckDatagram;
+  typedef udt_protocol::protocol_type::ControlView ControlView;
+  typedef udt_protocol::protocol_type::NAckView NAckView;
+  typedef connected_protocol::common::SequenceIntervalSet IntervalSet;
+  connected_protocol::SequenceGenerator seq_gen(0x7FFFFFFF);
+
+  NAckDatagram nack_datagram;
+  nack_datagram.payload().AddLossRange(5, 8);
+  nack_datagram.payload().AddLossPacket(12);
+  auto buffers = nack_datagram.GetConstBuffers();
+
+  ControlView control_view(buffers, boost::asio::buffer_size(buffers));
+  ASSERT_TRUE(control_view.IsValid());
+  IntervalSet loss_list(seq_gen);
+  NAckView(control_view).payload().InsertInto(&loss_list);
+
+  // The range end is retransmitted as well
+  EXPECT_EQ(2u, loss_list.intervals_count());
+  EXPECT_EQ(5u, loss_list.PopFront());
+  EXPECT_EQ(6u, loss_list.PopFront());
+  EXPECT_EQ(7u, loss_list.PopFront());
+  EXPECT_EQ(8u, loss_list.PopFront());
+  EXPECT_EQ(12u, loss_list.PopFront());
+  EXPECT_TRUE(loss_list.empty());
+}
+
+TEST(UDTTest, SessionTableEpochReclamation) {
+  typedef connected_protocol::common::SessionTable<int, int> Table;
+  Table table;
+
+  auto p_session = std::make_shared<int>(1);
+  EXPECT_TRUE(table.Insert(1, 100, p_session));
+  EXPECT_FALSE(table.Insert(1, 100, p_session));
+  EXPECT_EQ(p_session, table.Find(1, 100));
+  // Id known for another endpoint
+  EXPECT_TRUE(table.Find(1, 101) == nullptr);
+  EXPECT_TRUE(table.Contains(1));
+  EXPECT_EQ(2, p_session.use_count());
+
+  // The unlinked entry is retired, not freed, until the epoch moves on
+  table.Remove(1);
+  EXPECT_FALSE(table.Contains(1));
+  EXPECT_EQ(0u, table.size());
+  EXPECT_EQ(2, p_session.use_count());
+
+  EXPECT_TRUE(table.Insert(2, 100, std::make_shared<int>(2)));
+  table.Remove(2);
+  EXPECT_EQ(1, p_session.use_count());
+
+  // Growth retires the slot arrays and keeps every entry
+  std::vector<std::shared_ptr<int>> sessions;
+  for (int i = 0; i < 200; ++i) {
+    sessions.push_back(std::make_shared<int>(i));
+    EXPECT_TRUE(table.Insert(1000 + i, i, sessions.back()));
+  }
+  EXPECT_EQ(200u, table.size());
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_EQ(sessions[i], table.Find(1000 + i, i));
+  }
+  for (int i = 0; i < 200; i += 2) {
+    table.Remove(1000 + i);
+  }
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_EQ(i % 2 == 1, table.Contains(1000 + i));
+  }
+  EXPECT_EQ(1, sessions[0].use_count());
+}
+
+TEST(UDTTest, TimingWheelCascadeOrder) {
+  typedef connected_protocol::common::TimingWheel<int> Wheel;
+  Wheel wheel;
+
+  // Level 0, level 1, level 2, level 3 and overflow deadlines, unsorted
+  wheel.Insert(uint64_t(1) << 30, 5);
+  wheel.Insert(5000, 3);
+  wheel.Insert(70, 2);
+  wheel.Insert(300000, 4);
+  wheel.Insert(5, 0);
+  wheel.Insert(5, 1);
+  EXPECT_EQ(6u, wheel.size());
+
+  Wheel::Tick next_tick(0);
+  ASSERT_TRUE(wheel.NextTick(&next_tick));
+  EXPECT_EQ(5u, next_tick);
+  EXPECT_TRUE(wheel.Front(4) == nullptr);
+
+  // Same tick values are served in insertion order
+  const uint64_t deadlines[] = {5, 5, 70, 5000, 300000, uint64_t(1) << 30};
+  for (int value = 0; value < 6; ++value) {
+    EXPECT_TRUE(wheel.Front(deadlines[value] - 1) == nullptr);
+    int* p_front(wheel.Front(deadlines[value]));
+    ASSERT_TRUE(p_front != nullptr);
+    EXPECT_EQ(value, *p_front);
+    wheel.PopFront();
+  }
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(wheel.NextTick(&next_tick));
+
+  // Deadlines already passed are due at the cursor
+  wheel.Insert(10, 6);
+  int* p_front(wheel.Front(uint64_t(1) << 30));
+  ASSERT_TRUE(p_front != nullptr);
+  EXPECT_EQ(6, *p_front);
+}
+
 // TEST(UDTTestFixture, Coroutine) {
 //  typedef boost::asio::ip::tcp tcp;
 //
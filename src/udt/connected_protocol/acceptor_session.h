@@ -3,6 +3,7 @@
 
 #include <chrono>
 #include <memory>
+#include <vector>
 
 #include <boost/asio/detail/op_queue.hpp>
 
@@ -49,6 +50,7 @@ class AcceptorSession
  public:
   AcceptorSession()
       : p_multiplexer_(nullptr),
+        multiplexers_(),
         mutex_(),
         accept_ops_(),
         connecting_sessions_(),
@@ -59,8 +61,17 @@ class AcceptorSession
 
   ~AcceptorSession() { StopListen(); }
 
-  void set_p_multiplexer(MultiplexerPtr p_multiplexer) {
-    p_multiplexer_ = std::move(p_multiplexer);
+  /// Accept connections received by the multiplexer
+  /**
+  * Multiplexers sharding the same local endpoint are all added, the first one
+  * provides the local endpoint and the completion io_service.
+  */
+  void AddMultiplexer(MultiplexerPtr p_multiplexer) {
+    boost::recursive_mutex::scoped_lock lock(mutex_);
+    if (!p_multiplexer_) {
+      p_multiplexer_ = p_multiplexer;
+    }
+    multiplexers_.push_back(std::move(p_multiplexer));
   }
 
   bool IsListening() { return listening_; }
@@ -99,7 +110,15 @@ class AcceptorSession
     boost::system::error_code ec(::common::error::interrupted,
                                  ::common::error::get_error_category());
     Accept(ec);
-    p_multiplexer_->RemoveAcceptor();
+
+    std::vector<MultiplexerPtr> multiplexers;
+    {
+      boost::recursive_mutex::scoped_lock lock(mutex_);
+      multiplexers.swap(multiplexers_);
+    }
+    for (auto& p_multiplexer : multiplexers) {
+      p_multiplexer->RemoveAcceptor();
+    }
   }
 
   void PushAcceptOp(AcceptOp* p_accept_op) {
@@ -114,9 +133,14 @@ class AcceptorSession
     // @todo: should ec be swallowed here?
   }
 
+  /**
+  * @param p_multiplexer The multiplexer which received the datagram : it owns
+  *   the session created for the remote peer
+  */
   void PushConnectionDgr(ConnectionDatagramPtr p_connection_dgr,
-                         NextLayerEndpointPtr p_remote_endpoint) {
-    if (!p_multiplexer_) {
+                         NextLayerEndpointPtr p_remote_endpoint,
+                         MultiplexerPtr p_multiplexer) {
+    if (!p_multiplexer) {
       return;
     }
 
@@ -139,7 +163,8 @@ class AcceptorSession
     if (!p_socket_session) {
       // First handshake packet
       if (receive_cookie == 0 && destination_socket == 0) {
-        HandleFirstHandshakePacket(p_connection_dgr, *p_remote_endpoint);
+        HandleFirstHandshakePacket(p_connection_dgr, *p_remote_endpoint,
+                                   p_multiplexer);
         return;
       }
 
@@ -152,7 +177,7 @@ class AcceptorSession
       // New connection
       boost::system::error_code ec;
       p_socket_session =
-          p_multiplexer_->CreateSocketSession(ec, *p_remote_endpoint);
+          p_multiplexer->CreateSocketSession(ec, *p_remote_endpoint);
       if (ec) {
         BOOST_LOG_TRIVIAL(trace) << "Error on socket session creation";
       }
@@ -257,10 +282,8 @@ class AcceptorSession
 
   void HandleFirstHandshakePacket(
       ConnectionDatagramPtr p_connection_dgr,
-      const NextLayerEndpoint& next_remote_endpoint) {
-    if (!p_multiplexer_) {
-      return;
-    }
+      const NextLayerEndpoint& next_remote_endpoint,
+      const MultiplexerPtr& p_multiplexer) {
 
     auto& header = p_connection_dgr->header();
     auto& payload = p_connection_dgr->payload();
@@ -274,7 +297,7 @@ class AcceptorSession
     payload.set_maximum_window_flow_size(Protocol::MAXIMUM_WINDOW_FLOW_SIZE);
     payload.set_socket_id(0);
 
-    p_multiplexer_->AsyncSendControlPacket(
+    p_multiplexer->AsyncSendControlPacket(
         *p_connection_dgr, next_remote_endpoint,
         [p_connection_dgr](const boost::system::error_code&, std::size_t) {});
   }
@@ -299,6 +322,7 @@ class AcceptorSession
 
  private:
   MultiplexerPtr p_multiplexer_;
+  std::vector<MultiplexerPtr> multiplexers_;
   boost::recursive_mutex mutex_;
   AcceptOpQueue accept_ops_;
   RemoteSessionsMap connecting_sessions_;
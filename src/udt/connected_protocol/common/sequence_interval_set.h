@@ -0,0 +1,161 @@
+#ifndef UDT_CONNECTED_PROTOCOL_COMMON_SEQUENCE_INTERVAL_SET_H_
+#define UDT_CONNECTED_PROTOCOL_COMMON_SEQUENCE_INTERVAL_SET_H_
+
+#include <cstdint>
+
+#include <iterator>
+#include <map>
+
+#include "udt/connected_protocol/sequence_generator.h"
+
+namespace connected_protocol {
+namespace common {
+
+/// Set of sequence numbers stored as disjoint intervals
+/**
+* Overlapping or adjacent intervals are merged : a burst loss costs one
+* interval whatever its length. Sequence numbers are ordered with the
+* generator comparison, which wraps around : the stored numbers must span
+* less than half of the sequence space.
+*
+* Insert, Erase, EraseBefore and PopFront are O(log intervals) plus the
+* merged intervals.
+*/
+class SequenceIntervalSet {
+ public:
+  typedef SequenceGenerator::SeqNumber SeqNumber;
+
+  /// Inclusive interval [first, last]
+  struct Interval {
+    SeqNumber first;
+    SeqNumber last;
+  };
+
+ private:
+  struct SeqLess {
+    explicit SeqLess(const SequenceGenerator *seq_gen) : p_seq_gen(seq_gen) {}
+
+    bool operator()(SeqNumber lhs, SeqNumber rhs) const {
+      return p_seq_gen->Compare(lhs, rhs) < 0;
+    }
+
+    const SequenceGenerator *p_seq_gen;
+  };
+
+  // interval first -> interval last
+  typedef std::map<SeqNumber, SeqNumber, SeqLess> Intervals;
+
+ public:
+  typedef Intervals::const_iterator const_iterator;
+
+ public:
+  explicit SequenceIntervalSet(const SequenceGenerator &seq_gen)
+      : p_seq_gen_(&seq_gen), intervals_(SeqLess(&seq_gen)) {}
+
+  bool empty() const { return intervals_.empty(); }
+
+  std::size_t intervals_count() const { return intervals_.size(); }
+
+  /// Intervals in sequence order, as (first, last) pairs
+  const_iterator begin() const { return intervals_.begin(); }
+  const_iterator end() const { return intervals_.end(); }
+
+  /// @return smallest sequence number, the set must not be empty
+  SeqNumber Front() const { return intervals_.begin()->first; }
+
+  void Insert(SeqNumber seq) { Insert(seq, seq); }
+
+  /// Insert [first, last], merged with the intervals it overlaps or touches
+  /// @return stored interval containing [first, last]
+  Interval Insert(SeqNumber first, SeqNumber last) {
+    auto next_it = intervals_.upper_bound(first);
+    if (next_it != intervals_.begin()) {
+      auto previous_it = std::prev(next_it);
+      if (!Less(p_seq_gen_->Inc(previous_it->second), first)) {
+        first = previous_it->first;
+        last = Max(last, previous_it->second);
+        intervals_.erase(previous_it);
+      }
+    }
+
+    while (next_it != intervals_.end() &&
+           !Less(p_seq_gen_->Inc(last), next_it->first)) {
+      last = Max(last, next_it->second);
+      next_it = intervals_.erase(next_it);
+    }
+
+    intervals_.emplace_hint(next_it, first, last);
+    return Interval{first, last};
+  }
+
+  void Erase(SeqNumber seq) {
+    auto interval_it = intervals_.upper_bound(seq);
+    if (interval_it == intervals_.begin()) {
+      return;
+    }
+    --interval_it;
+    if (Less(interval_it->second, seq)) {
+      return;
+    }
+
+    SeqNumber first(interval_it->first);
+    SeqNumber last(interval_it->second);
+    interval_it = intervals_.erase(interval_it);
+    if (last != seq) {
+      interval_it = intervals_.emplace_hint(interval_it, p_seq_gen_->Inc(seq),
+                                            last);
+    }
+    if (first != seq) {
+      intervals_.emplace_hint(interval_it, first, p_seq_gen_->Dec(seq));
+    }
+  }
+
+  /// Erase the sequence numbers lower than seq
+  void EraseBefore(SeqNumber seq) {
+    while (!intervals_.empty()) {
+      auto front_it = intervals_.begin();
+      if (!Less(front_it->first, seq)) {
+        return;
+      }
+
+      SeqNumber last(front_it->second);
+      front_it = intervals_.erase(front_it);
+      if (!Less(last, seq)) {
+        intervals_.emplace_hint(front_it, seq, last);
+        return;
+      }
+    }
+  }
+
+  /// Remove and return the smallest sequence number, the set must not be
+  /// empty
+  SeqNumber PopFront() {
+    auto front_it = intervals_.begin();
+    SeqNumber seq(front_it->first);
+    SeqNumber last(front_it->second);
+    front_it = intervals_.erase(front_it);
+    if (seq != last) {
+      intervals_.emplace_hint(front_it, p_seq_gen_->Inc(seq), last);
+    }
+
+    return seq;
+  }
+
+ private:
+  bool Less(SeqNumber lhs, SeqNumber rhs) const {
+    return p_seq_gen_->Compare(lhs, rhs) < 0;
+  }
+
+  SeqNumber Max(SeqNumber lhs, SeqNumber rhs) const {
+    return Less(lhs, rhs) ? rhs : lhs;
+  }
+
+ private:
+  const SequenceGenerator *p_seq_gen_;
+  Intervals intervals_;
+};
+
+}  // common
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_COMMON_SEQUENCE_INTERVAL_SET_H_
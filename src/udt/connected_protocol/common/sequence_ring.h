@@ -0,0 +1,152 @@
+#ifndef UDT_CONNECTED_PROTOCOL_COMMON_SEQUENCE_RING_H_
+#define UDT_CONNECTED_PROTOCOL_COMMON_SEQUENCE_RING_H_
+
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+namespace connected_protocol {
+namespace common {
+
+/// Circular buffer of values indexed by sequence number
+/**
+* Holds the values of a contiguous sequence window [first, first + span) :
+* the value of seq lives in slot seq & (capacity - 1). Slots of the window
+* may be empty (erased out of order). Erasing the first value moves the
+* window start to the next stored value.
+*
+* Find, Insert at the end of the window and Erase are O(1). The capacity is
+* a power of two, doubled when the window outgrows it and never shrunk.
+*
+* @tparam Value Nullable value (e.g. unique_ptr), empty slots are Value()
+*/
+template <class Value>
+class SequenceRing {
+ public:
+  typedef uint32_t SeqNumber;
+
+ public:
+  /**
+  * @param max_sequence Largest sequence number before wrapping to 0, one
+  *   less than a power of two
+  * @param capacity Initial number of slots, rounded up to a power of two
+  */
+  SequenceRing(SeqNumber max_sequence, std::size_t capacity)
+      : max_sequence_(max_sequence),
+        slots_(RoundCapacity(capacity)),
+        mask_(slots_.size() - 1),
+        first_(0),
+        span_(0),
+        size_(0) {}
+
+  bool empty() const { return size_ == 0; }
+
+  /// @return number of stored values
+  std::size_t size() const { return size_; }
+
+  /// @return first sequence number of the window
+  SeqNumber first_sequence() const { return first_; }
+
+  /// @return number of sequence numbers in the window, stored or not
+  std::size_t span() const { return span_; }
+
+  SeqNumber Inc(SeqNumber seq) const { return (seq + 1) & max_sequence_; }
+
+  /// Store value for seq, extending the window up to seq
+  /// @return false if seq is before the window start
+  bool Insert(SeqNumber seq, Value value) {
+    if (size_ == 0) {
+      first_ = seq;
+      span_ = 0;
+    }
+
+    std::size_t offset(Offset(seq));
+    if (offset > (max_sequence_ >> 1)) {
+      return false;
+    }
+
+    if (offset >= span_) {
+      Reserve(offset + 1);
+      span_ = offset + 1;
+    }
+
+    Value &slot = slots_[seq & mask_];
+    if (!slot) {
+      ++size_;
+    }
+    slot = std::move(value);
+    return true;
+  }
+
+  /// @return stored value of seq, nullptr if none
+  Value *Find(SeqNumber seq) {
+    if (Offset(seq) >= span_) {
+      return nullptr;
+    }
+
+    Value &slot = slots_[seq & mask_];
+    return slot ? &slot : nullptr;
+  }
+
+  void Erase(SeqNumber seq) {
+    Value *p_value = Find(seq);
+    if (!p_value) {
+      return;
+    }
+
+    *p_value = Value();
+    --size_;
+    if (size_ == 0) {
+      span_ = 0;
+      return;
+    }
+
+    // Move the window start to the next stored value
+    while (!slots_[first_ & mask_]) {
+      first_ = Inc(first_);
+      --span_;
+    }
+  }
+
+ private:
+  static std::size_t RoundCapacity(std::size_t capacity) {
+    std::size_t rounded(1);
+    while (rounded < capacity) {
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+  std::size_t Offset(SeqNumber seq) const {
+    return (seq - first_) & max_sequence_;
+  }
+
+  void Reserve(std::size_t span) {
+    if (span <= slots_.size()) {
+      return;
+    }
+
+    std::vector<Value> slots(RoundCapacity(span));
+    std::size_t mask(slots.size() - 1);
+    SeqNumber seq(first_);
+    for (std::size_t i = 0; i < span_; ++i, seq = Inc(seq)) {
+      slots[seq & mask] = std::move(slots_[seq & mask_]);
+    }
+    slots_.swap(slots);
+    mask_ = mask;
+  }
+
+ private:
+  SeqNumber max_sequence_;
+  std::vector<Value> slots_;
+  std::size_t mask_;
+  SeqNumber first_;
+  std::size_t span_;
+  std::size_t size_;
+};
+
+}  // common
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_COMMON_SEQUENCE_RING_H_
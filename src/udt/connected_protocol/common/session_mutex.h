@@ -0,0 +1,50 @@
+#ifndef UDT_CONNECTED_PROTOCOL_COMMON_SESSION_MUTEX_H_
+#define UDT_CONNECTED_PROTOCOL_COMMON_SESSION_MUTEX_H_
+
+#include <boost/thread/lock_types.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace connected_protocol {
+namespace common {
+
+/// Mutex guarding session protocol state, skipped for serialized sessions
+/**
+* A serialized session runs all its protocol work (datagrams, pacing pulls,
+* timers, user ops) on one single threaded io_service : its state needs no
+* locking and the mutex is left untouched.
+*
+* The mode is set before the session is shared between threads.
+*/
+class SessionMutex {
+ public:
+  typedef boost::unique_lock<SessionMutex> scoped_lock;
+
+ public:
+  explicit SessionMutex(bool serialized = false)
+      : mutex_(), serialized_(serialized) {}
+
+  void set_serialized(bool serialized) { serialized_ = serialized; }
+
+  void lock() {
+    if (!serialized_) {
+      mutex_.lock();
+    }
+  }
+
+  bool try_lock() { return serialized_ || mutex_.try_lock(); }
+
+  void unlock() {
+    if (!serialized_) {
+      mutex_.unlock();
+    }
+  }
+
+ private:
+  boost::mutex mutex_;
+  bool serialized_;
+};
+
+}  // common
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_COMMON_SESSION_MUTEX_H_
@@ -0,0 +1,280 @@
+#ifndef UDT_CONNECTED_PROTOCOL_COMMON_SESSION_TABLE_H_
+#define UDT_CONNECTED_PROTOCOL_COMMON_SESSION_TABLE_H_
+
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+namespace connected_protocol {
+namespace common {
+
+/// Sessions indexed by socket id, looked up without lock
+/**
+* Open addressing hash table (linear probing, power of two capacity) of
+* immutable entries. Lookups only read atomic slots; inserts and removes are
+* serialized by an internal mutex.
+*
+* Unlinked entries and replaced slot arrays are retired and freed with epoch
+* based reclamation: readers announce themselves in the counter of the
+* current epoch parity, and the writer frees what was retired two epochs ago
+* once the readers of that parity have left.
+*
+* @tparam Session Session type, stored as shared_ptr
+* @tparam Endpoint Remote endpoint type, validated on lookup
+*/
+template <class Session, class Endpoint>
+class SessionTable {
+ public:
+  typedef uint32_t SocketId;
+  typedef std::shared_ptr<Session> SessionPtr;
+
+ private:
+  enum : std::size_t { INITIAL_CAPACITY = 64 };
+
+  struct Entry {
+    Entry(SocketId id, const Endpoint& remote_endpoint, SessionPtr p_session)
+        : socket_id(id),
+          endpoint(remote_endpoint),
+          p_session(std::move(p_session)) {}
+
+    const SocketId socket_id;
+    const Endpoint endpoint;
+    const SessionPtr p_session;
+  };
+
+  struct Slots {
+    explicit Slots(std::size_t capacity)
+        : mask(capacity - 1), p_slots(new std::atomic<Entry*>[capacity]) {
+      for (std::size_t i = 0; i < capacity; ++i) {
+        p_slots[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    std::size_t capacity() const { return mask + 1; }
+
+    const std::size_t mask;
+    std::unique_ptr<std::atomic<Entry*>[]> p_slots;
+  };
+
+  /// Reader announced in an epoch for the lifetime of the guard
+  class ReadGuard {
+   public:
+    explicit ReadGuard(const SessionTable& table) : p_readers_(nullptr) {
+      for (;;) {
+        uint32_t epoch(table.epoch_.load());
+        p_readers_ = &table.readers_[epoch & 1];
+        p_readers_->fetch_add(1);
+        if (table.epoch_.load() == epoch) {
+          return;
+        }
+        // Epoch moved between load and announce : retry in the new one
+        p_readers_->fetch_sub(1);
+      }
+    }
+
+    ~ReadGuard() { p_readers_->fetch_sub(1); }
+
+   private:
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+   private:
+    std::atomic<uint32_t>* p_readers_;
+  };
+
+ public:
+  SessionTable()
+      : write_mutex_(),
+        p_slots_(new Slots(INITIAL_CAPACITY)),
+        size_(0),
+        used_slots_(0),
+        epoch_(0),
+        retired_entries_(),
+        retired_slots_() {
+    readers_[0] = 0;
+    readers_[1] = 0;
+  }
+
+  ~SessionTable() {
+    Slots* p_slots(p_slots_.load());
+    for (std::size_t i = 0; i < p_slots->capacity(); ++i) {
+      Entry* p_entry(p_slots->p_slots[i].load());
+      if (p_entry != nullptr && p_entry != Tombstone()) {
+        delete p_entry;
+      }
+    }
+    delete p_slots;
+    for (int parity = 0; parity < 2; ++parity) {
+      Free(parity);
+    }
+  }
+
+  /// Lock free lookup
+  /**
+  * @return the session registered with socket_id for remote_endpoint, null
+  *   if none or if the id belongs to another endpoint
+  */
+  SessionPtr Find(SocketId socket_id, const Endpoint& remote_endpoint) const {
+    ReadGuard guard(*this);
+    const Entry* p_entry(FindEntry(*p_slots_.load(), socket_id));
+    if (p_entry == nullptr || !(p_entry->endpoint == remote_endpoint)) {
+      return nullptr;
+    }
+
+    return p_entry->p_session;
+  }
+
+  bool Contains(SocketId socket_id) const {
+    ReadGuard guard(*this);
+    return FindEntry(*p_slots_.load(), socket_id) != nullptr;
+  }
+
+  /// @return false if socket_id is already registered
+  bool Insert(SocketId socket_id, const Endpoint& remote_endpoint,
+              SessionPtr p_session) {
+    boost::mutex::scoped_lock lock(write_mutex_);
+    Slots* p_slots(p_slots_.load());
+    if (FindEntry(*p_slots, socket_id) != nullptr) {
+      return false;
+    }
+
+    if ((used_slots_ + 1) * 2 > p_slots->capacity()) {
+      p_slots = Rehash(size_ * 4 > p_slots->capacity()
+                           ? p_slots->capacity() * 2
+                           : p_slots->capacity());
+    }
+
+    std::size_t index(Hash(socket_id) & p_slots->mask);
+    for (;;) {
+      Entry* p_current(p_slots->p_slots[index].load());
+      if (p_current == nullptr || p_current == Tombstone()) {
+        if (p_current == nullptr) {
+          ++used_slots_;
+        }
+        p_slots->p_slots[index].store(
+            new Entry(socket_id, remote_endpoint, std::move(p_session)));
+        ++size_;
+        return true;
+      }
+      index = (index + 1) & p_slots->mask;
+    }
+  }
+
+  void Remove(SocketId socket_id) {
+    boost::mutex::scoped_lock lock(write_mutex_);
+    Slots* p_slots(p_slots_.load());
+    std::size_t index(Hash(socket_id) & p_slots->mask);
+    for (std::size_t probe = 0; probe < p_slots->capacity(); ++probe) {
+      Entry* p_current(p_slots->p_slots[index].load());
+      if (p_current == nullptr) {
+        return;
+      }
+      if (p_current != Tombstone() && p_current->socket_id == socket_id) {
+        p_slots->p_slots[index].store(Tombstone());
+        --size_;
+        Retire(p_current);
+        return;
+      }
+      index = (index + 1) & p_slots->mask;
+    }
+  }
+
+  std::size_t size() const {
+    boost::mutex::scoped_lock lock(write_mutex_);
+    return size_;
+  }
+
+ private:
+  static Entry* Tombstone() {
+    static Entry* const p_tombstone(reinterpret_cast<Entry*>(1));
+    return p_tombstone;
+  }
+
+  static std::size_t Hash(SocketId socket_id) {
+    // Fibonacci hashing : ids are random but may share their low bits when
+    // sharded (id % shards_count == shard)
+    return static_cast<std::size_t>((socket_id * 2654435769u) >> 7);
+  }
+
+  static const Entry* FindEntry(const Slots& slots, SocketId socket_id) {
+    std::size_t index(Hash(socket_id) & slots.mask);
+    for (std::size_t probe = 0; probe < slots.capacity(); ++probe) {
+      const Entry* p_current(slots.p_slots[index].load());
+      if (p_current == nullptr) {
+        return nullptr;
+      }
+      if (p_current != Tombstone() && p_current->socket_id == socket_id) {
+        return p_current;
+      }
+      index = (index + 1) & slots.mask;
+    }
+
+    return nullptr;
+  }
+
+  /// Publish a new slot array without tombstones, write lock held
+  Slots* Rehash(std::size_t capacity) {
+    Slots* p_old_slots(p_slots_.load());
+    Slots* p_new_slots(new Slots(capacity));
+    for (std::size_t i = 0; i < p_old_slots->capacity(); ++i) {
+      Entry* p_entry(p_old_slots->p_slots[i].load());
+      if (p_entry == nullptr || p_entry == Tombstone()) {
+        continue;
+      }
+      std::size_t index(Hash(p_entry->socket_id) & p_new_slots->mask);
+      while (p_new_slots->p_slots[index].load(std::memory_order_relaxed) !=
+             nullptr) {
+        index = (index + 1) & p_new_slots->mask;
+      }
+      p_new_slots->p_slots[index].store(p_entry, std::memory_order_relaxed);
+    }
+    used_slots_ = size_;
+    p_slots_.store(p_new_slots);
+    retired_slots_[epoch_.load() & 1].emplace_back(p_old_slots);
+    TryAdvanceEpoch();
+
+    return p_new_slots;
+  }
+
+  /// Write lock held
+  void Retire(Entry* p_entry) {
+    retired_entries_[epoch_.load() & 1].emplace_back(p_entry);
+    TryAdvanceEpoch();
+  }
+
+  /// Free what was retired in the previous epoch if its readers are gone
+  void TryAdvanceEpoch() {
+    uint32_t epoch(epoch_.load());
+    uint32_t previous_parity((epoch + 1) & 1);
+    if (readers_[previous_parity].load() != 0) {
+      return;
+    }
+    Free(previous_parity);
+    epoch_.store(epoch + 1);
+  }
+
+  void Free(uint32_t parity) {
+    retired_entries_[parity].clear();
+    retired_slots_[parity].clear();
+  }
+
+ private:
+  mutable boost::mutex write_mutex_;
+  std::atomic<Slots*> p_slots_;
+  std::size_t size_;
+  /// Slots not null (entries and tombstones)
+  std::size_t used_slots_;
+  std::atomic<uint32_t> epoch_;
+  mutable std::atomic<uint32_t> readers_[2];
+  std::vector<std::unique_ptr<Entry>> retired_entries_[2];
+  std::vector<std::unique_ptr<Slots>> retired_slots_[2];
+};
+
+}  // common
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_COMMON_SESSION_TABLE_H_
@@ -0,0 +1,256 @@
+#ifndef UDT_CONNECTED_PROTOCOL_COMMON_TIMING_WHEEL_H_
+#define UDT_CONNECTED_PROTOCOL_COMMON_TIMING_WHEEL_H_
+
+#include <cstdint>
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace connected_protocol {
+namespace common {
+
+/// Hierarchical timing wheel of values ordered by deadline tick
+/**
+* LEVELS wheels of SLOTS slots : a slot of level l spans SLOTS^l ticks. A
+* value is stored at the lowest level where its deadline shares the cursor
+* rotation, and moves down a level (cascade) when the cursor enters its slot.
+* Deadlines beyond the last level wait in an overflow list until the cursor
+* enters their last level rotation.
+*
+* The cursor never passes a stored deadline nor the tick given to Front :
+* values inserted with a deadline before the cursor are due at the cursor.
+* Values of a level 0 slot share their tick and are served in insertion
+* order.
+*
+* Insert and PopFront are O(1), Front is O(LEVELS) plus the cascaded values.
+*
+* @tparam Value Stored value type
+*/
+template <class Value>
+class TimingWheel {
+ public:
+  typedef uint64_t Tick;
+
+  enum : uint32_t { SLOT_BITS = 6, SLOTS = 1 << SLOT_BITS, LEVELS = 4 };
+
+ private:
+  struct Entry {
+    Entry(Tick deadline_tick, Value entry_value)
+        : deadline(deadline_tick), value(std::move(entry_value)) {}
+
+    Tick deadline;
+    Value value;
+  };
+
+  typedef std::deque<Entry> Slot;
+
+ public:
+  TimingWheel() : cursor_(0), size_(0), slots_(LEVELS * SLOTS), overflow_() {
+    for (uint32_t level = 0; level < LEVELS; ++level) {
+      occupied_[level] = 0;
+    }
+  }
+
+  bool empty() const { return size_ == 0; }
+
+  std::size_t size() const { return size_; }
+
+  void Insert(Tick deadline, Value value) {
+    ++size_;
+    Place(Entry(deadline, std::move(value)));
+  }
+
+  /// Earliest tick at which Front may return a value
+  /**
+  * Exact for values in level 0, the start of their slot otherwise.
+  *
+  * @return false if the wheel is empty
+  */
+  bool NextTick(Tick* p_tick) const {
+    if (size_ == 0) {
+      return false;
+    }
+
+    Tick next_tick(0);
+    uint32_t level(0);
+    if (!NextEvent(&next_tick, &level)) {
+      // Only overflow values : wait for the next last level rotation
+      next_tick = NextRotation(LEVELS);
+    }
+    *p_tick = next_tick;
+
+    return true;
+  }
+
+  /// Move the cursor up to limit and get the earliest due value
+  /**
+  * @return the value with the earliest deadline if not after limit, null
+  *   otherwise. Stays valid until the next modification of the wheel
+  */
+  Value* Front(Tick limit) {
+    Advance(limit);
+    Slot* p_slot(FrontSlot());
+    if (p_slot == nullptr || SlotTick(0, FirstOccupied(0)) > limit) {
+      return nullptr;
+    }
+
+    return &p_slot->front().value;
+  }
+
+  /// Remove the value returned by the last Front call
+  void PopFront() {
+    uint32_t index(FirstOccupied(0));
+    Slot& slot(slots_[index]);
+    slot.pop_front();
+    if (slot.empty()) {
+      occupied_[0] &= ~(uint64_t(1) << index);
+    }
+    --size_;
+  }
+
+ private:
+  void Place(Entry entry) {
+    if (entry.deadline < cursor_) {
+      entry.deadline = cursor_;
+    }
+
+    Tick distance(entry.deadline ^ cursor_);
+    for (uint32_t level = 0; level < LEVELS; ++level) {
+      if (distance < (Tick(1) << ((level + 1) * SLOT_BITS))) {
+        uint32_t index(static_cast<uint32_t>(
+            (entry.deadline >> (level * SLOT_BITS)) & (SLOTS - 1)));
+        slots_[level * SLOTS + index].push_back(std::move(entry));
+        occupied_[level] |= uint64_t(1) << index;
+        return;
+      }
+    }
+
+    overflow_.push_back(std::move(entry));
+  }
+
+  /// Move the cursor towards limit, cascading entered slots
+  void Advance(Tick limit) {
+    while (cursor_ < limit) {
+      Tick next_tick(0);
+      uint32_t level(0);
+      bool found(NextEvent(&next_tick, &level));
+      if (!overflow_.empty() && (!found || NextRotation(LEVELS) < next_tick)) {
+        next_tick = NextRotation(LEVELS);
+        level = LEVELS;
+        found = true;
+      }
+
+      if (!found || next_tick > limit) {
+        cursor_ = limit;
+        return;
+      }
+
+      cursor_ = next_tick;
+      if (level == 0) {
+        // A value is due
+        return;
+      }
+
+      Cascade(level);
+    }
+  }
+
+  /// Redistribute the values of the slot (or overflow) the cursor entered
+  void Cascade(uint32_t level) {
+    std::vector<Entry> entries;
+    if (level == LEVELS) {
+      entries.reserve(overflow_.size());
+      for (auto& entry : overflow_) {
+        entries.push_back(std::move(entry));
+      }
+      overflow_.clear();
+    } else {
+      uint32_t index(CursorIndex(level));
+      Slot& slot(slots_[level * SLOTS + index]);
+      entries.reserve(slot.size());
+      for (auto& entry : slot) {
+        entries.push_back(std::move(entry));
+      }
+      slot.clear();
+      occupied_[level] &= ~(uint64_t(1) << index);
+    }
+
+    for (auto& entry : entries) {
+      Place(std::move(entry));
+    }
+  }
+
+  /// Earliest occupied slot : exact tick in level 0, slot start above
+  bool NextEvent(Tick* p_tick, uint32_t* p_level) const {
+    bool found(false);
+    for (uint32_t level = 0; level < LEVELS; ++level) {
+      if (occupied_[level] == 0) {
+        continue;
+      }
+      Tick tick(SlotTick(level, FirstOccupied(level)));
+      if (!found || tick < *p_tick) {
+        *p_tick = tick;
+        *p_level = level;
+        found = true;
+      }
+    }
+
+    return found;
+  }
+
+  Slot* FrontSlot() {
+    if (occupied_[0] == 0) {
+      return nullptr;
+    }
+
+    return &slots_[FirstOccupied(0)];
+  }
+
+  /// Occupied slots are never before the cursor in their rotation
+  uint32_t FirstOccupied(uint32_t level) const {
+    uint64_t occupied(occupied_[level]);
+#if defined(__GNUC__)
+    return static_cast<uint32_t>(__builtin_ctzll(occupied));
+#else
+    uint32_t index(0);
+    while ((occupied & 1) == 0) {
+      occupied >>= 1;
+      ++index;
+    }
+    return index;
+#endif  // defined(__GNUC__)
+  }
+
+  uint32_t CursorIndex(uint32_t level) const {
+    return static_cast<uint32_t>((cursor_ >> (level * SLOT_BITS)) &
+                                 (SLOTS - 1));
+  }
+
+  /// First tick of a slot in the cursor rotation of its level
+  Tick SlotTick(uint32_t level, uint32_t index) const {
+    uint32_t shift((level + 1) * SLOT_BITS);
+    Tick rotation_start((cursor_ >> shift) << shift);
+
+    return rotation_start + (Tick(index) << (level * SLOT_BITS));
+  }
+
+  /// First tick of the next rotation of a level
+  Tick NextRotation(uint32_t level) const {
+    uint32_t shift(level * SLOT_BITS);
+
+    return ((cursor_ >> shift) + 1) << shift;
+  }
+
+ private:
+  Tick cursor_;
+  std::size_t size_;
+  std::vector<Slot> slots_;
+  uint64_t occupied_[LEVELS];
+  std::vector<Entry> overflow_;
+};
+
+}  // common
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_COMMON_TIMING_WHEEL_H_
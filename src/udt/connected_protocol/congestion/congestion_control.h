@@ -1,6 +1,8 @@
 #ifndef UDT_CONNECTED_PROTOCOL_CONGESTION_CONGESTION_CONTROL_H_
 #define UDT_CONNECTED_PROTOCOL_CONGESTION_CONGESTION_CONTROL_H_
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 
 #include <boost/chrono.hpp>
@@ -9,6 +11,7 @@
 
 #include "udt/connected_protocol/sequence_generator.h"
 #include "udt/connected_protocol/cache/connection_info.h"
+#include "udt/connected_protocol/congestion/shared_congestion_state.h"
 
 namespace connected_protocol {
 namespace congestion {
@@ -27,10 +30,10 @@ class CongestionControl {
   typedef std::shared_ptr<SendDatagram> SendDatagramPtr;
   typedef typename Protocol::DataDatagram DataDatagram;
   typedef std::shared_ptr<DataDatagram> DataDatagramPtr;
-  typedef typename Protocol::AckDatagram AckDatagram;
-  typedef std::shared_ptr<AckDatagram> AckDatagramPtr;
-  typedef typename Protocol::NAckDatagram NAckDatagram;
-  typedef std::shared_ptr<NAckDatagram> NAckDatagramPtr;
+  typedef typename Protocol::DataView DataView;
+  typedef typename Protocol::AckView AckView;
+  typedef typename Protocol::NAckView NAckView;
+  typedef SharedCongestionState::Ptr SharedCongestionStatePtr;
 
   CongestionControl(ConnectionInfo *p_connection_info)
       : p_connection_info_(p_connection_info),
@@ -44,7 +47,16 @@ class CongestionControl {
         nack_count_(1),
         dec_count_(1),
         last_dec_sending_period_(1.0),
-        dec_random_(1) {}
+        dec_random_(1),
+        p_shared_state_(nullptr),
+        p_weight_(nullptr),
+        weight_(1) {}
+
+  ~CongestionControl() {
+    if (p_shared_state_) {
+      p_shared_state_->Unregister(weight_.load());
+    }
+  }
 
   void Init(packet_sequence_number_type init_packet_seq_num,
             uint32_t max_window_size) {
@@ -54,9 +66,32 @@ class CongestionControl {
     last_update_ = Clock::now();
   }
 
+  /// Send at a share of the rate of the flow instead of probing alone
+  /**
+  * Skip slow start if the flow already learned its rate.
+  *
+  * @param p_shared_state Rate state of the flow
+  * @param weight Share of the session in the flow rate, read again each
+  *   time the share is computed. Must outlive the congestion control
+  */
+  void Share(SharedCongestionStatePtr p_shared_state,
+             const std::atomic<uint32_t> &weight) {
+    p_shared_state_ = std::move(p_shared_state);
+    p_weight_ = &weight;
+    weight_ = std::max<uint32_t>(1, weight.load());
+    p_shared_state_->Register(weight_.load());
+    if (p_shared_state_->learned()) {
+      slow_start_phase_ = false;
+      sending_period_ = p_shared_state_->sending_period(Weight());
+      window_flow_size_ = p_shared_state_->window_flow_size(Weight());
+      p_connection_info_->set_window_flow_size(window_flow_size_.load());
+      p_connection_info_->set_sending_period(sending_period_.load());
+    }
+  }
+
   void OnPacketSent(const SendDatagram &datagram) {}
 
-  void OnAck(const AckDatagram &ack_dgr,
+  void OnAck(const AckView &ack_dgr,
              const SequenceGenerator &packet_seq_gen) {
     double syn_interval = (double)p_connection_info_->syn_interval();
     double rtt = (double)p_connection_info_->rtt().count();
@@ -89,6 +124,7 @@ class CongestionControl {
         } else {
           sending_period_ = ((rtt + syn_interval) / window_flow_size_);
         }
+        LearnSharedRate();
       }
     } else {
       UpdateWindowFlowSize();
@@ -108,7 +144,11 @@ class CongestionControl {
     double min_inc = 0.01;
     double inc(0.0);
 
-    double B = estimated_link_capacity - (1000000.0 / (sending_period_.load()));
+    // The flow rate is what competes for the link in shared mode
+    double current_sending_period(p_shared_state_
+                                      ? p_shared_state_->sending_period()
+                                      : sending_period_.load());
+    double B = estimated_link_capacity - (1000000.0 / current_sending_period);
     if ((sending_period_.load() > last_dec_sending_period_.load()) &&
         ((estimated_link_capacity / 9) < B)) {
       B = estimated_link_capacity / 9;
@@ -122,17 +162,24 @@ class CongestionControl {
         inc = min_inc;
       }
     }
-    sending_period_ = (sending_period_.load() * syn_interval) /
-                      (sending_period_.load() * inc + syn_interval);
+    if (p_shared_state_) {
+      p_shared_state_->Increase(inc, syn_interval);
+      sending_period_ = p_shared_state_->sending_period(Weight());
+    } else {
+      sending_period_ = (sending_period_.load() * syn_interval) /
+                        (sending_period_.load() * inc + syn_interval);
+    }
 
     p_connection_info_->set_sending_period(sending_period_.load());
   }
 
-  void OnLoss(const NAckDatagram &nack_dgr,
+  void OnLoss(const NAckView &nack_dgr,
               const connected_protocol::SequenceGenerator &seq_gen) {
-    std::vector<uint32_t> loss_list(nack_dgr.payload().GetLossPackets());
+    if (nack_dgr.payload().loss_packets_count() == 0) {
+      return;
+    }
     packet_sequence_number_type first_loss_list_seq =
-        GetSequenceNumber(loss_list[0]);
+        GetSequenceNumber(nack_dgr.payload().loss_packet(0));
 
     double syn_interval = (double)p_connection_info_->syn_interval();
     double rtt = (double)p_connection_info_->rtt().count();
@@ -143,16 +190,18 @@ class CongestionControl {
 
       if (packet_arrival_speed > 0) {
         sending_period_ = (1000000.0 / packet_arrival_speed);
+        LearnSharedRate();
         return;
       }
       sending_period_ = (window_flow_size_.load() / (rtt + syn_interval));
+      LearnSharedRate();
     }
 
     loss_phase_ = true;
 
     if (seq_gen.Compare(first_loss_list_seq, last_dec_seq_num_.load()) > 0) {
       last_dec_sending_period_ = sending_period_.load();
-      sending_period_ = sending_period_.load() * 1.125;
+      DecreaseRate();
 
       avg_nack_num_ = (uint32_t)ceil(avg_nack_num_.load() * 0.875 +
                                      nack_count_.load() * 0.125);
@@ -169,14 +218,14 @@ class CongestionControl {
       nack_count_ = nack_count_.load() + 1;
       if (dec_count_.load() < 5 &&
           0 == (nack_count_.load() % dec_random_.load())) {
-        sending_period_ = sending_period_.load() * 1.125;
+        DecreaseRate();
         last_dec_seq_num_ = last_send_seq_num_.load();
       }
       dec_count_ = dec_count_.load() + 1;
     }
   }
 
-  void OnPacketReceived(const DataDatagram &datagram) {}
+  void OnPacketReceived(const DataView &data_view) {}
 
   void OnTimeout() {}
 
@@ -198,6 +247,11 @@ class CongestionControl {
   }
 
   boost::chrono::nanoseconds sending_period() const {
+    if (p_shared_state_ && !slow_start_phase_.load()) {
+      // Follow the flow rate as soon as another session changes it
+      return boost::chrono::nanoseconds(
+          (long long)ceil(p_shared_state_->sending_period(Weight()) * 1000));
+    }
     return boost::chrono::nanoseconds(
         (long long)ceil(sending_period_.load() * 1000));
   }
@@ -212,6 +266,37 @@ class CongestionControl {
     return seq_num & 0x7FFFFFFF;
   }
 
+  void LearnSharedRate() {
+    if (!p_shared_state_) {
+      return;
+    }
+    p_shared_state_->Learn(sending_period_.load(), window_flow_size_.load(),
+                           Weight());
+    sending_period_ = p_shared_state_->sending_period(Weight());
+  }
+
+  void DecreaseRate() {
+    if (!p_shared_state_) {
+      sending_period_ = sending_period_.load() * 1.125;
+      return;
+    }
+    p_shared_state_->Decrease(1.125, p_connection_info_->rtt());
+    sending_period_ = p_shared_state_->sending_period(Weight());
+  }
+
+  /// Current SEND_WEIGHT of the session, moved in the flow total when it
+  /// changed since the last share
+  uint32_t Weight() const {
+    uint32_t weight(std::max<uint32_t>(1, p_weight_->load()));
+    uint32_t previous_weight(weight_.exchange(weight));
+    if (previous_weight != weight) {
+      p_shared_state_->Register(weight);
+      p_shared_state_->Unregister(previous_weight);
+    }
+
+    return weight;
+  }
+
  private:
   ConnectionInfo *p_connection_info_;
   std::atomic<double> window_flow_size_;
@@ -230,6 +315,12 @@ class CongestionControl {
   std::atomic<packet_sequence_number_type> last_send_seq_num_;
   std::atomic<uint32_t> dec_random_;
   TimePoint last_update_;
+  // rate of the flow, null when the session probes alone
+  SharedCongestionStatePtr p_shared_state_;
+  // SEND_WEIGHT of the session
+  const std::atomic<uint32_t> *p_weight_;
+  // weight counted in the flow total
+  mutable std::atomic<uint32_t> weight_;
 };
 
 }  // congestion
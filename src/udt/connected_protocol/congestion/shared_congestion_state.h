@@ -0,0 +1,140 @@
+#ifndef UDT_CONNECTED_PROTOCOL_CONGESTION_SHARED_CONGESTION_STATE_H_
+#define UDT_CONNECTED_PROTOCOL_CONGESTION_SHARED_CONGESTION_STATE_H_
+
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+
+#include <boost/chrono.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace connected_protocol {
+namespace congestion {
+
+/// Sending rate shared by the sessions of a flow (congestion manager mode)
+/**
+* The path to a remote endpoint is probed once for all its sessions : the
+* state holds the aggregate sending period, each session sends at the share
+* of its weight. Increases are applied once per syn interval and decreases
+* once per rtt, whichever session triggers them.
+*
+* Sessions keep their own sequence number bookkeeping (loss epochs, slow
+* start window) and only exchange rates through this state.
+*/
+class SharedCongestionState {
+ public:
+  typedef std::shared_ptr<SharedCongestionState> Ptr;
+
+ private:
+  typedef boost::chrono::high_resolution_clock Clock;
+  typedef Clock::time_point TimePoint;
+
+ public:
+  SharedCongestionState()
+      : mutex_(),
+        total_weight_(0),
+        learned_(false),
+        sending_period_(0.0),
+        window_flow_size_(16.0),
+        last_increase_(),
+        last_decrease_() {}
+
+  void Register(uint32_t weight) { total_weight_.fetch_add(weight); }
+
+  void Unregister(uint32_t weight) { total_weight_.fetch_sub(weight); }
+
+  /// A session left slow start : new sessions start at the learned rate
+  bool learned() const { return learned_.load(); }
+
+  /// First session leaving slow start sets the aggregate from its own rate
+  /**
+  * @param sending_period Sending period of the session in micro seconds
+  * @param window_flow_size Window of the session in packets
+  * @param weight Weight of the session
+  */
+  void Learn(double sending_period, double window_flow_size, uint32_t weight) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (learned_.load()) {
+      return;
+    }
+
+    double share(Share(weight));
+    sending_period_ = sending_period * share;
+    window_flow_size_ = window_flow_size / share;
+    last_increase_ = Clock::now();
+    learned_ = true;
+  }
+
+  /// Additive increase of the aggregate rate (UDT increase formula)
+  /**
+  * @param inc Packets per syn interval to add
+  * @param syn_interval Syn interval in micro seconds
+  */
+  void Increase(double inc, double syn_interval) {
+    boost::mutex::scoped_lock lock(mutex_);
+    TimePoint now(Clock::now());
+    if (now - last_increase_ < boost::chrono::microseconds(
+                                   static_cast<long long>(syn_interval))) {
+      return;
+    }
+    last_increase_ = now;
+
+    double sending_period(sending_period_.load());
+    sending_period_ =
+        (sending_period * syn_interval) / (sending_period * inc + syn_interval);
+  }
+
+  /// Multiplicative decrease of the aggregate rate
+  /**
+  * @param factor Sending period multiplier
+  * @param rtt Round trip time of the reporting session
+  */
+  void Decrease(double factor, boost::chrono::microseconds rtt) {
+    boost::mutex::scoped_lock lock(mutex_);
+    TimePoint now(Clock::now());
+    if (now - last_decrease_ < rtt) {
+      return;
+    }
+    last_decrease_ = now;
+
+    sending_period_ = sending_period_.load() * factor;
+  }
+
+  /// Aggregate sending period in micro seconds
+  double sending_period() const { return sending_period_.load(); }
+
+  /// Sending period of a session in micro seconds
+  double sending_period(uint32_t weight) const {
+    return sending_period_.load() / Share(weight);
+  }
+
+  /// Window of a session in packets
+  double window_flow_size(uint32_t weight) const {
+    double window_flow_size(window_flow_size_.load() * Share(weight));
+    return window_flow_size > 16.0 ? window_flow_size : 16.0;
+  }
+
+ private:
+  double Share(uint32_t weight) const {
+    uint32_t total_weight(total_weight_.load());
+    return total_weight > weight ? static_cast<double>(weight) / total_weight
+                                 : 1.0;
+  }
+
+ private:
+  boost::mutex mutex_;
+  std::atomic<uint32_t> total_weight_;
+  std::atomic<bool> learned_;
+  // aggregate, in micro seconds
+  std::atomic<double> sending_period_;
+  // aggregate, in packets
+  std::atomic<double> window_flow_size_;
+  TimePoint last_increase_;
+  TimePoint last_decrease_;
+};
+
+}  // congestion
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_CONGESTION_SHARED_CONGESTION_STATE_H_
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include <boost/asio/buffer.hpp>
+#include <boost/chrono.hpp>
 
 #include "udt/connected_protocol/io/buffers.h"
 
@@ -22,24 +23,40 @@ class basic_Datagram {
   typedef io::fixed_const_buffer_sequence ConstBuffers;
   typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   enum { size = Header::size + Payload::size };
+  /// Kernel receive time, unset (epoch) if unknown
+  typedef boost::chrono::high_resolution_clock::time_point ArrivalTimePoint;
+  /// Owner notified when a send of the datagram ended
+  typedef void (*SentCallback)(void* p_context, basic_Datagram* p_datagram);
 
  public:
   basic_Datagram()
-      : header_(), payload_(), pending_send_(false), acked_(false) {}
+      : header_(),
+        payload_(),
+        pending_send_(false),
+        acked_(false),
+        arrival_time_(),
+        sent_callback_(nullptr),
+        p_sent_context_(nullptr) {}
 
   basic_Datagram(Header header, Payload payload)
-      : header_(std::move(header)), payload_(std::move(payload)) {}
+      : header_(std::move(header)),
+        payload_(std::move(payload)),
+        sent_callback_(nullptr),
+        p_sent_context_(nullptr) {}
 
   template <class OtherPayload>
   basic_Datagram(basic_Datagram<Header, OtherPayload> datagram)
       : header_(std::move(datagram.header)),
-        payload_(std::move(datagram.payload)) {}
+        payload_(std::move(datagram.payload)),
+        sent_callback_(nullptr),
+        p_sent_context_(nullptr) {}
 
   basic_Datagram& operator=(const basic_Datagram& other) {
     header_ = other.header_;
     payload_ = other.payload_;
     pending_send_ = other.pending_send_;
     acked_ = other.acked_;
+    arrival_time_ = other.arrival_time_;
 
     return *this;
   }
@@ -49,6 +66,7 @@ class basic_Datagram {
     payload_ = std::move(other.payload_);
     pending_send_ = other.pending_send_.load();
     acked_ = other.acked_.load();
+    arrival_time_ = other.arrival_time_;
 
     return *this;
   }
@@ -62,7 +80,9 @@ class basic_Datagram {
     return buffers;
   }
 
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
+  /// @tparam Buffers fixed or array buffer sequence
+  template <class Buffers>
+  void GetConstBuffers(Buffers* p_buffers) const {
     header_.GetConstBuffers(p_buffers);
     payload_.GetConstBuffers(p_buffers);
   }
@@ -74,7 +94,8 @@ class basic_Datagram {
     return buffers;
   }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
+  template <class Buffers>
+  void GetMutableBuffers(Buffers* p_buffers) {
     header_.GetMutableBuffers(p_buffers);
     payload_.GetMutableBuffers(p_buffers);
   }
@@ -93,11 +114,36 @@ class basic_Datagram {
 
   bool is_acked() { return acked_.load(); }
 
+  void set_arrival_time(const ArrivalTimePoint& arrival_time) {
+    arrival_time_ = arrival_time;
+  }
+
+  const ArrivalTimePoint& arrival_time() const { return arrival_time_; }
+
+  /// The owner sets pending send before handing the datagram out and clears
+  /// it in the callback
+  void set_sent_callback(SentCallback sent_callback, void* p_sent_context) {
+    sent_callback_ = sent_callback;
+    p_sent_context_ = p_sent_context;
+  }
+
+  /// Send ended, sent or not : notify the owner once per hand out
+  void OnSent() {
+    if (sent_callback_) {
+      sent_callback_(p_sent_context_, this);
+    } else {
+      pending_send_ = false;
+    }
+  }
+
  private:
   Header header_;
   Payload payload_;
   std::atomic<bool> pending_send_;
   std::atomic<bool> acked_;
+  ArrivalTimePoint arrival_time_;
+  SentCallback sent_callback_;
+  void* p_sent_context_;
 };
 
 }  // datagram
@@ -29,7 +29,8 @@ class basic_GenericHeader {
     return std::move(buffers);
   }
 
-  void GetConstBuffers(ConstBuffers *p_buffers) const {
+  template <class Buffers>
+  void GetConstBuffers(Buffers *p_buffers) const {
     p_buffers->push_back(boost::asio::buffer(data_));
   }
 
@@ -39,7 +40,8 @@ class basic_GenericHeader {
     return std::move(buffers);
   }
 
-  void GetMutableBuffers(MutableBuffers *p_buffers) {
+  template <class Buffers>
+  void GetMutableBuffers(Buffers *p_buffers) {
     p_buffers->push_back(boost::asio::buffer(data_));
   }
 
@@ -110,7 +112,8 @@ class basic_DataHeader {
     return std::move(buffers);
   }
 
-  void GetConstBuffers(ConstBuffers *p_buffers) const {
+  template <class Buffers>
+  void GetConstBuffers(Buffers *p_buffers) const {
     p_buffers->push_back(boost::asio::buffer(&content_, sizeof(content_)));
   }
 
@@ -120,7 +123,8 @@ class basic_DataHeader {
     return std::move(buffers);
   }
 
-  void GetMutableBuffers(MutableBuffers *p_buffers) {
+  template <class Buffers>
+  void GetMutableBuffers(Buffers *p_buffers) {
     p_buffers->push_back(boost::asio::buffer(&content_, sizeof(content_)));
   }
 
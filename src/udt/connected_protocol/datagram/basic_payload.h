@@ -3,10 +3,12 @@
 
 #include <cstdint>
 
+#include <algorithm>
 #include <array>
 #include <vector>
 
 #include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
 
 #include "udt/common/error/error.h"
 
@@ -40,7 +42,8 @@ class BufferPayload {
     return ConstBuffers(boost::asio::const_buffers_1(buf));
   }
 
-  void GetConstBuffers(ConstBuffers* p_buffers) const {
+  template <class Buffers>
+  void GetConstBuffers(Buffers* p_buffers) const {
     p_buffers->push_back(boost::asio::buffer(data_, size_) + offset_);
   }
 
@@ -50,7 +53,8 @@ class BufferPayload {
     return MutableBuffers(boost::asio::mutable_buffers_1(buf));
   }
 
-  void GetMutableBuffers(MutableBuffers* p_buffers) {
+  template <class Buffers>
+  void GetMutableBuffers(Buffers* p_buffers) {
     p_buffers->push_back(boost::asio::buffer(data_, size_) + offset_);
   }
 
@@ -66,61 +70,135 @@ class BufferPayload {
   uint32_t offset_;
 };
 
+/// Data payload to send, referencing caller buffers or holding a copy
+/**
+* Zero copy : AddConstBuffer references up to MAX_BUFFERS caller buffers,
+* which must stay valid until the packet is acknowledged. Copy :
+* GetMutableBuffers exposes an owned storage, filled then sized with SetSize.
+*
+* The last packet of a write carries the write op, completed once the
+* packet is acknowledged (acks are cumulative : the whole write is).
+*/
 template <uint64_t MaximumSize>
 class ConstBufferSequencePayload {
  public:
   typedef io::fixed_const_buffer_sequence ConstBuffers;
+  typedef io::fixed_mutable_buffer_sequence MutableBuffers;
   typedef connected_protocol::io::basic_pending_write_operation SizedOp;
   enum { size = MaximumSize };
+  /// Send batches gather the header and 3 buffers per datagram
+  enum { MAX_BUFFERS = 3 };
 
   ConstBufferSequencePayload()
-      : buffers_(), current_size_(0), p_sized_op_(nullptr), total_copy_(0) {}
-
-  bool AddConstBuffer(const ConstBuffers::value_type& buffer) {
-    if (boost::asio::buffer_size(buffers_) + boost::asio::buffer_size(buffer) >
-        MaximumSize) {
+      : data_(),
+        buffers_(),
+        buffers_count_(0),
+        current_size_(0),
+        owned_(false),
+        p_sized_op_(nullptr),
+        total_copy_(0) {}
+
+  /// Reference a caller buffer
+  /// @return false if the buffer does not fit
+  bool AddConstBuffer(const boost::asio::const_buffer& buffer) {
+    std::size_t buffer_size(boost::asio::buffer_size(buffer));
+    if (owned_ || buffers_count_ == MAX_BUFFERS ||
+        current_size_ + buffer_size > MaximumSize) {
       return false;
     }
-    buffers_.push_back(buffer);
-    current_size_ += boost::asio::buffer_size(buffer);
+    buffers_[buffers_count_++] = buffer;
+    current_size_ += buffer_size;
     return true;
   }
 
-  std::size_t RemainingSize() { return MaximumSize - current_size_; }
+  /// Empty the payload, to reuse it for a new packet
+  void Reset() {
+    buffers_count_ = 0;
+    current_size_ = 0;
+    owned_ = false;
+    p_sized_op_ = nullptr;
+    total_copy_ = 0;
+  }
+
+  std::size_t RemainingSize() const {
+    return buffers_count_ == MAX_BUFFERS ? 0 : MaximumSize - current_size_;
+  }
 
-  bool IsFull() { return MaximumSize == current_size_; }
+  bool IsFull() const { return RemainingSize() == 0; }
 
-  ConstBuffers GetConstBuffers() const { return buffers_; }
+  ConstBuffers GetConstBuffers() const {
+    ConstBuffers buffers;
+    GetConstBuffers(&buffers);
+    return buffers;
+  }
 
   void GetConstBuffers(ConstBuffers* p_buffers) const {
-    for (auto buffer : buffers_) {
-      p_buffers->push_back(buffer);
+    if (owned_) {
+      p_buffers->push_back(boost::asio::buffer(data_, current_size_));
+      return;
     }
+    for (uint32_t i = 0; i < buffers_count_; ++i) {
+      p_buffers->push_back(buffers_[i]);
+    }
+  }
+
+  /// Owned storage, to copy the data into
+  MutableBuffers GetMutableBuffers() {
+    owned_ = true;
+    return MutableBuffers(boost::asio::mutable_buffers_1(
+        boost::asio::buffer(data_, current_size_)));
+  }
+
+  /// Copy up to max_size bytes from the reader into the owned storage
+  /// @return number of bytes copied
+  template <class BufferReader>
+  std::size_t CopyFrom(BufferReader* p_reader, std::size_t max_size) {
+    owned_ = true;
+    current_size_ = p_reader->Read(
+        data_.data(), std::min<std::size_t>(max_size, MaximumSize));
+    return current_size_;
   }
 
+  uint32_t GetSize() const { return static_cast<uint32_t>(current_size_); }
+
+  /// Size of the owned storage
+  void SetSize(uint32_t new_size) {
+    owned_ = true;
+    current_size_ = std::min<std::size_t>(new_size, MaximumSize);
+  }
+
+  /// Complete the write op on acknowledgement with total_copy bytes
   void set_p_sized_op(SizedOp* p_sized_op) { p_sized_op_ = p_sized_op; }
 
   void set_total_copy(std::size_t total_copy) { total_copy_ = total_copy; }
 
-  void complete(boost::asio::io_service& io_service) {
-    if (p_sized_op_ != nullptr && total_copy_ != 0) {
-      // Execute handler
-      auto p_sized_op = p_sized_op_;
-      auto total_copy = total_copy_;
-
-      auto do_complete = [p_sized_op, total_copy]() {
-        p_sized_op->complete(
-            boost::system::error_code(::common::error::success,
-                                      ::common::error::get_error_category()),
-            total_copy);
-      };
-      io_service.post(do_complete);
+  /// Post the write op completion once, if the packet carries one
+  void complete(boost::asio::io_service& io_service,
+                const boost::system::error_code& ec =
+                    boost::system::error_code(
+                        ::common::error::success,
+                        ::common::error::get_error_category())) {
+    if (p_sized_op_ == nullptr) {
+      return;
     }
+
+    // Execute handler
+    auto p_sized_op = p_sized_op_;
+    auto total_copy = ec ? 0 : total_copy_;
+    p_sized_op_ = nullptr;
+
+    auto do_complete = [p_sized_op, ec, total_copy]() {
+      p_sized_op->complete(ec, total_copy);
+    };
+    io_service.post(do_complete);
   }
 
  private:
-  ConstBuffers buffers_;
+  std::array<uint8_t, MaximumSize> data_;
+  std::array<boost::asio::const_buffer, MAX_BUFFERS> buffers_;
+  uint32_t buffers_count_;
   std::size_t current_size_;
+  bool owned_;
   SizedOp* p_sized_op_;
   std::size_t total_copy_;
 };
@@ -0,0 +1,241 @@
+#ifndef UDT_CONNECTED_PROTOCOL_DATAGRAM_CONTROL_VIEW_H_
+#define UDT_CONNECTED_PROTOCOL_DATAGRAM_CONTROL_VIEW_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+
+#include <boost/asio/buffer.hpp>
+
+#include "udt/connected_protocol/datagram/basic_header.h"
+
+namespace connected_protocol {
+namespace datagram {
+
+namespace detail {
+
+/// Read a 32 bits network order word from an unaligned buffer
+inline uint32_t LoadWord(const uint8_t* p_data) {
+  uint32_t word;
+  std::memcpy(&word, p_data, sizeof(word));
+  return ntohl(word);
+}
+
+}  // detail
+
+/// Read-only control header decoded in place from received bytes
+class basic_ControlHeaderView {
+ public:
+  typedef basic_ControlHeader::type type;
+  enum { size = basic_ControlHeader::size };
+
+ public:
+  explicit basic_ControlHeaderView(const uint8_t* p_data) : p_data_(p_data) {}
+
+  uint32_t flags() const { return detail::LoadWord(p_data_) & 0x7FFF0000; }
+
+  uint32_t reserved() const { return detail::LoadWord(p_data_) & 0x0000FFFF; }
+
+  uint32_t additional_info() const {
+    return detail::LoadWord(p_data_ + 4) & 0x1FFFFFFF;
+  }
+
+  uint32_t timestamp() const { return detail::LoadWord(p_data_ + 8); }
+
+  uint32_t destination_socket() const {
+    return detail::LoadWord(p_data_ + 12);
+  }
+
+  bool IsType(type type) const { return flags() == type; }
+
+ private:
+  const uint8_t* p_data_;
+};
+
+/// Received control packet viewed in place
+/**
+* The view is valid as long as the receive buffer is : it must not be kept
+* after the dispatch returns.
+*/
+class basic_ControlView {
+ public:
+  typedef basic_ControlHeaderView Header;
+
+ public:
+  /**
+  * @param buffers Received bytes, the header contiguous at the front and the
+  *   payload contiguous after it (in the same or the next buffer)
+  * @param length Datagram size, header included
+  */
+  template <class ConstBufferSequence>
+  basic_ControlView(const ConstBufferSequence& buffers, std::size_t length)
+      : header_(nullptr),
+        p_payload_(nullptr),
+        payload_size_(0),
+        valid_(false) {
+    std::size_t index(0);
+    for (const auto& buffer : buffers) {
+      const uint8_t* p_data =
+          boost::asio::buffer_cast<const uint8_t*>(buffer);
+      std::size_t buffer_size(boost::asio::buffer_size(buffer));
+      if (index == 0) {
+        if (buffer_size < Header::size || length < Header::size) {
+          return;
+        }
+        header_ = Header(p_data);
+        p_payload_ = p_data + Header::size;
+        payload_size_ = buffer_size - Header::size;
+      } else if (payload_size_ == 0) {
+        p_payload_ = p_data;
+        payload_size_ = buffer_size;
+      }
+      ++index;
+    }
+
+    if (index == 0) {
+      return;
+    }
+    payload_size_ = std::min(payload_size_, length - Header::size);
+    valid_ = true;
+  }
+
+  bool IsValid() const { return valid_; }
+
+  const Header& header() const { return header_; }
+
+  const uint8_t* payload_data() const { return p_payload_; }
+
+  std::size_t payload_size() const { return payload_size_; }
+
+ private:
+  Header header_;
+  const uint8_t* p_payload_;
+  std::size_t payload_size_;
+  bool valid_;
+};
+
+/// Typed control packet view
+/**
+* @tparam PayloadView Read-only payload decoder built from (data, size)
+*/
+template <class PayloadView>
+class basic_ControlDatagramView {
+ public:
+  typedef basic_ControlHeaderView Header;
+  typedef PayloadView Payload;
+
+ public:
+  explicit basic_ControlDatagramView(const basic_ControlView& control)
+      : header_(control.header()),
+        payload_(control.payload_data(), control.payload_size()) {}
+
+  const Header& header() const { return header_; }
+
+  const Payload& payload() const { return payload_; }
+
+ private:
+  Header header_;
+  Payload payload_;
+};
+
+class basic_AckPayloadView {
+ public:
+  basic_AckPayloadView(const uint8_t* p_data, std::size_t size)
+      : p_data_(p_data), size_(size) {}
+
+  uint32_t max_packet_sequence_number() const { return Word(0); }
+
+  uint32_t rtt() const { return Word(1); }
+
+  uint32_t rtt_var() const { return Word(2); }
+
+  uint32_t available_buffer_size() const { return Word(3); }
+
+  uint32_t packet_arrival_speed() const { return Word(4); }
+
+  uint32_t estimated_link_capacity() const { return Word(5); }
+
+  bool IsLightAck() const { return size_ == 4; }
+
+  bool IsFull() const { return size_ > 16; }
+
+ private:
+  /// @return 0 for fields absent from a light or partial ACK
+  uint32_t Word(std::size_t index) const {
+    return (index + 1) * 4 <= size_ ? detail::LoadWord(p_data_ + index * 4)
+                                    : 0;
+  }
+
+ private:
+  const uint8_t* p_data_;
+  std::size_t size_;
+};
+
+class basic_NAckPayloadView {
+ public:
+  typedef uint32_t packet_sequence_number_type;
+
+ public:
+  basic_NAckPayloadView(const uint8_t* p_data, std::size_t size)
+      : p_data_(p_data), count_(size / 4) {}
+
+  std::size_t loss_packets_count() const { return count_; }
+
+  /// @return loss entry in host order, first bit set for a range start
+  packet_sequence_number_type loss_packet(std::size_t index) const {
+    return detail::LoadWord(p_data_ + index * 4);
+  }
+
+  /// Insert the lost packets, a range [first, last] including last
+  /**
+  * @tparam LossList Providing Insert(seq) and Insert(first, last)
+  */
+  template <class LossList>
+  void InsertInto(LossList* p_loss_list) const {
+    for (std::size_t i = 0; i < count_; ++i) {
+      packet_sequence_number_type current_seq(loss_packet(i));
+      if (!IsRangeStart(current_seq)) {
+        p_loss_list->Insert(current_seq);
+        continue;
+      }
+      ++i;
+      // Drop a range start without its end
+      if (i < count_ && !IsRangeStart(loss_packet(i))) {
+        p_loss_list->Insert(current_seq & 0x7FFFFFFF, loss_packet(i));
+      }
+    }
+  }
+
+ private:
+  static bool IsRangeStart(packet_sequence_number_type loss_entry) {
+    return 0 != (loss_entry & 0x80000000);
+  }
+
+ private:
+  const uint8_t* p_data_;
+  std::size_t count_;
+};
+
+class basic_MessageDropRequestPayloadView {
+ public:
+  basic_MessageDropRequestPayloadView(const uint8_t* p_data, std::size_t size)
+      : p_data_(p_data), size_(size) {}
+
+  uint32_t first_sequence_number() const {
+    return size_ >= 4 ? detail::LoadWord(p_data_) : 0;
+  }
+
+  uint32_t last_sequence_number() const {
+    return size_ >= 8 ? detail::LoadWord(p_data_ + 4) : 0;
+  }
+
+ private:
+  const uint8_t* p_data_;
+  std::size_t size_;
+};
+
+}  // datagram
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_DATAGRAM_CONTROL_VIEW_H_
@@ -0,0 +1,86 @@
+#ifndef UDT_CONNECTED_PROTOCOL_DATAGRAM_DATA_VIEW_H_
+#define UDT_CONNECTED_PROTOCOL_DATAGRAM_DATA_VIEW_H_
+
+#include <cstdint>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/chrono.hpp>
+
+#include "udt/connected_protocol/datagram/basic_header.h"
+#include "udt/connected_protocol/io/buffers.h"
+
+namespace connected_protocol {
+namespace datagram {
+
+/// Received data packet : decoded header and a view on the payload
+/**
+* The payload stays in the receive buffer (read slot, batch slot, coalesced
+* segment or io_uring buffer) : the view must not be kept after the dispatch
+* returns, the receiver copies what it stores.
+*/
+class basic_DataView {
+ public:
+  typedef basic_DataHeader Header;
+  typedef io::datagram_const_buffers PayloadBuffers;
+  /// Kernel receive time, unset (epoch) if unknown
+  typedef boost::chrono::high_resolution_clock::time_point ArrivalTimePoint;
+
+ public:
+  /**
+  * @param buffers Received bytes, header included
+  * @param length Datagram size, header included
+  * @param arrival_time Kernel receive time, unset if unknown
+  */
+  template <class ConstBufferSequence>
+  basic_DataView(const ConstBufferSequence& buffers, std::size_t length,
+                 const ArrivalTimePoint& arrival_time = ArrivalTimePoint())
+      : header_(),
+        payload_(),
+        payload_size_(0),
+        arrival_time_(arrival_time) {
+    if (length < Header::size) {
+      return;
+    }
+    io::datagram_mutable_buffers header_buffers;
+    header_.GetMutableBuffers(&header_buffers);
+    boost::asio::buffer_copy(header_buffers, buffers);
+    payload_size_ = length - Header::size;
+    payload_ = io::SliceBuffers<PayloadBuffers>(buffers, Header::size,
+                                                payload_size_);
+  }
+
+  const Header& header() const { return header_; }
+
+  const PayloadBuffers& payload() const { return payload_; }
+
+  std::size_t payload_size() const { return payload_size_; }
+
+  const ArrivalTimePoint& arrival_time() const { return arrival_time_; }
+
+  /// Copy the packet into a datagram which outlives the receive buffer
+  template <class Datagram>
+  void CopyTo(Datagram* p_datagram) const {
+    io::datagram_const_buffers header_buffers;
+    header_.GetConstBuffers(&header_buffers);
+    io::datagram_mutable_buffers buffers;
+    p_datagram->header().GetMutableBuffers(&buffers);
+    boost::asio::buffer_copy(buffers, header_buffers);
+
+    p_datagram->payload().SetSize(static_cast<uint32_t>(payload_size_));
+    io::datagram_mutable_buffers payload_buffers;
+    p_datagram->payload().GetMutableBuffers(&payload_buffers);
+    boost::asio::buffer_copy(payload_buffers, payload_);
+    p_datagram->set_arrival_time(arrival_time_);
+  }
+
+ private:
+  Header header_;
+  PayloadBuffers payload_;
+  std::size_t payload_size_;
+  ArrivalTimePoint arrival_time_;
+};
+
+}  // datagram
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_DATAGRAM_DATA_VIEW_H_
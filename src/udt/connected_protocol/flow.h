@@ -4,8 +4,9 @@
 #include <cstdint>
 
 #include <chrono>
-#include <set>
+#include <deque>
 #include <memory>
+#include <unordered_map>
 
 #include <boost/asio/buffer.hpp>
 
@@ -13,8 +14,12 @@
 
 #include <boost/bind.hpp>
 
+#include <boost/thread/thread.hpp>
+
 #include <boost/system/error_code.hpp>
 
+#include "udt/connected_protocol/common/timing_wheel.h"
+#include "udt/connected_protocol/congestion/shared_congestion_state.h"
 #include "udt/connected_protocol/logger/log_entry.h"
 
 namespace connected_protocol {
@@ -38,47 +43,116 @@ class Flow : public std::enable_shared_from_this<Flow<Protocol>> {
   typedef typename Protocol::logger Logger;
   typedef typename Protocol::socket_session SocketSession;
 
-  struct CompareSessionPacketSendingTime {
-    bool operator()(typename SocketSession::Ptr p_lhs,
-                    typename SocketSession::Ptr p_rhs) {
-      return p_lhs->NextScheduledPacketTime() <
-             p_rhs->NextScheduledPacketTime();
-    }
+  // Wheel entry, stale once its session is scheduled again
+  struct ScheduledSession {
+    typename SocketSession::Ptr p_session;
+    uint64_t generation;
   };
 
-  typedef std::set<typename SocketSession::Ptr, CompareSessionPacketSendingTime>
-      SocketsContainer;
+  // Sessions keyed by the micro second their next packet is due
+  typedef common::TimingWheel<ScheduledSession> SocketsContainer;
+  typedef typename SocketsContainer::Tick Tick;
+
+  // Where a registered session is waiting
+  struct SessionSchedule {
+    // generation of its live wheel entry
+    uint64_t generation;
+    Tick deadline;
+    // in a round robin rather than in the wheel
+    bool active;
+  };
+
+  // Due session in the deficit round robin, deficit in bytes
+  struct ActiveSession {
+    typename SocketSession::Ptr p_session;
+    int64_t deficit;
+  };
 
  public:
   typedef std::shared_ptr<Flow> Ptr;
 
  public:
-  static Ptr Create(boost::asio::io_service& io_service) {
-    return Ptr(new Flow(io_service));
+  /**
+  * @param max_batch_size Maximum packets pulled per wakeup
+  * @param spin_time Final part of a wait spent yielding instead of on the
+  *   timer, which overshoots short waits
+  * @param departure_horizon How early packets are pulled and handed to the
+  *   multiplexer with their departure time (kernel pacing), 0 to pull them
+  *   when due
+  * @param shared_congestion Sessions of the flow share one sending rate
+  */
+  static Ptr Create(boost::asio::io_service& io_service,
+                    uint32_t max_batch_size = 1,
+                    boost::chrono::microseconds spin_time =
+                        boost::chrono::microseconds(0),
+                    boost::chrono::microseconds departure_horizon =
+                        boost::chrono::microseconds(0),
+                    bool shared_congestion = false) {
+    return Ptr(new Flow(io_service, max_batch_size, spin_time,
+                        departure_horizon, shared_congestion));
+  }
+
+  /// Thread pulling the sessions, running serialized sessions as well
+  boost::asio::io_service& get_io_service() { return io_service_; }
+
+  /// Rate state shared by the sessions, null if each session probes alone
+  congestion::SharedCongestionState::Ptr shared_congestion_state() const {
+    return p_shared_congestion_state_;
   }
 
   void RegisterNewSocket(typename SocketSession::Ptr p_session) {
     {
       boost::mutex::scoped_lock lock(mutex_);
-      socket_sessions_.insert(p_session);
+      Schedule(p_session);
     }
 
     StartPullingSocketQueue();
   }
 
+  /// Switch between kernel pacing (horizon > 0) and timer pacing
+  void set_departure_horizon(boost::chrono::microseconds departure_horizon) {
+    departure_horizon_ = departure_horizon.count();
+  }
+
   void Log(connected_protocol::logger::LogEntry* p_log) {
     p_log->flow_sent_count = sent_count_.load();
+    uint32_t sent_count(sent_count_.load());
+    p_log->flow_pacing_error_mean =
+        sent_count > 0
+            ? static_cast<double>(pacing_error_sum_.load()) / sent_count
+            : 0.0;
+    p_log->flow_pacing_error_max = pacing_error_max_.load();
   }
 
-  void ResetLog() { sent_count_ = 0; }
+  void ResetLog() {
+    sent_count_ = 0;
+    pacing_error_sum_ = 0;
+    pacing_error_max_ = 0;
+  }
 
  private:
-  Flow(boost::asio::io_service& io_service)
+  Flow(boost::asio::io_service& io_service, uint32_t max_batch_size,
+       boost::chrono::microseconds spin_time,
+       boost::chrono::microseconds departure_horizon, bool shared_congestion)
       : io_service_(io_service),
+        max_batch_size_(max_batch_size > 0 ? max_batch_size : 1),
+        spin_time_(spin_time),
+        departure_horizon_(departure_horizon.count()),
         mutex_(),
         socket_sessions_(),
+        priority_sessions_(),
+        active_sessions_(),
+        scheduled_sessions_(),
+        next_generation_(0),
         next_packet_timer_(io_service),
-        pulling_(false) {}
+        pulling_(false),
+        p_shared_congestion_state_(
+            shared_congestion
+                ? std::make_shared<congestion::SharedCongestionState>()
+                : nullptr),
+        sent_count_(0),
+        pacing_error_sum_(0),
+        pacing_error_max_(0) {}
 
   void StartPullingSocketQueue() {
     if (pulling_.load()) {
@@ -88,27 +162,80 @@ class Flow : public std::enable_shared_from_this<Flow<Protocol>> {
     PullSocketQueue();
   }
 
-  void PullSocketQueue() {
-    typename SocketsContainer::iterator p_next_socket_expired_it;
+  /// Add the session to the wheel at its next packet time, mutex_ held
+  /**
+  * A session already in the wheel is inserted again if its deadline moved,
+  * its previous entry is left stale. Active sessions are scheduled when
+  * deactivated.
+  */
+  void Schedule(const typename SocketSession::Ptr& p_session) {
+    Tick deadline(ToTick(p_session->NextScheduledPacketTime()));
+    auto inserted = scheduled_sessions_.emplace(
+        p_session.get(), SessionSchedule{0, deadline, false});
+    SessionSchedule& schedule(inserted.first->second);
+    if (!inserted.second &&
+        (schedule.active || schedule.deadline == deadline)) {
+      return;
+    }
+
+    InsertInWheel(p_session, deadline, &schedule);
+  }
+
+  /// Make a new wheel entry the live one of the session, mutex_ held
+  void InsertInWheel(const typename SocketSession::Ptr& p_session,
+                     Tick deadline, SessionSchedule* p_schedule) {
+    p_schedule->generation = ++next_generation_;
+    p_schedule->deadline = deadline;
+    p_schedule->active = false;
+    ScheduledSession scheduled_session = {p_session, p_schedule->generation};
+    socket_sessions_.Insert(deadline, std::move(scheduled_session));
+  }
+
+  /// @return true if the wheel entry is the live one of its session
+  bool IsLive(const ScheduledSession& scheduled_session) const {
+    auto schedule_it =
+        scheduled_sessions_.find(scheduled_session.p_session.get());
+    return schedule_it != scheduled_sessions_.end() &&
+           !schedule_it->second.active &&
+           schedule_it->second.generation == scheduled_session.generation;
+  }
+
+  static Tick ToTick(const TimePoint& time_point) {
+    int64_t tick(boost::chrono::duration_cast<boost::chrono::microseconds>(
+                     time_point.time_since_epoch())
+                     .count());
+    return tick > 0 ? static_cast<Tick>(tick) : 0;
+  }
+
+  static TimePoint ToTimePoint(Tick tick) {
+    return TimePoint(boost::chrono::microseconds(tick));
+  }
 
+  void PullSocketQueue() {
     if (!pulling_.load()) {
       return;
     }
 
     {
       boost::mutex::scoped_lock lock_socket_sessions(mutex_);
-      if (socket_sessions_.empty()) {
+      Tick next_tick;
+      bool has_active_session(!priority_sessions_.empty() ||
+                              !active_sessions_.empty());
+      if (!has_active_session && !socket_sessions_.NextTick(&next_tick)) {
         this->StopPullSocketQueue();
         return;
       }
 
-      p_next_socket_expired_it = socket_sessions_.begin();
-
-      auto next_scheduled_packet_interval =
-          (*p_next_socket_expired_it)->NextScheduledPacketTime();
+      boost::chrono::microseconds departure_horizon(departure_horizon_.load());
+      TimePoint timer_time(
+          has_active_session
+              ? Clock::now()
+              : ToTimePoint(next_tick) - (departure_horizon.count() > 0
+                                              ? departure_horizon
+                                              : spin_time_));
 
-      if (next_scheduled_packet_interval.count() <= 0) {
-        // Resend immediatly
+      if (timer_time <= Clock::now()) {
+        // Due, or close enough to spin until it is (or to let the kernel wait)
         boost::system::error_code ec;
         ec.assign(::common::error::success,
                   ::common::error::get_error_category());
@@ -117,7 +244,7 @@ class Flow : public std::enable_shared_from_this<Flow<Protocol>> {
         return;
       }
 
-      next_packet_timer_.expires_from_now(next_scheduled_packet_interval);
+      next_packet_timer_.expires_at(timer_time);
       next_packet_timer_.async_wait(boost::bind(&Flow::WaitPullSocketHandler,
                                                 this->shared_from_this(), _1));
     }
@@ -137,54 +264,202 @@ class Flow : public std::enable_shared_from_this<Flow<Protocol>> {
       return;
     }
 
-    typename SocketSession::Ptr p_session;
-    Datagram* p_datagram;
-    {
-      boost::mutex::scoped_lock lock_socket_sessions(mutex_);
+    boost::chrono::microseconds departure_horizon(departure_horizon_.load());
+    if (departure_horizon.count() <= 0) {
+      SpinUntilDue();
+    }
 
-      if (socket_sessions_.empty()) {
-        StopPullSocketQueue();
-        return;
+    // Pull every packet already due (or due within the departure horizon),
+    // up to the batch size, so that they are handed to the multiplexer in the
+    // same send batch. Late sessions catch up here
+    for (uint32_t i = 0; i < max_batch_size_; ++i) {
+      typename SocketSession::Ptr p_session;
+      Datagram* p_datagram;
+      TimePoint scheduled_time;
+      {
+        boost::mutex::scoped_lock lock_socket_sessions(mutex_);
+
+        if (scheduled_sessions_.empty()) {
+          StopPullSocketQueue();
+          return;
+        }
+
+        TimePoint due_time(Clock::now() + departure_horizon);
+        ActivateDueSessions(due_time);
+
+        // Empty when woken at the start of a wheel slot to cascade
+        if (!priority_sessions_.empty()) {
+          p_session = std::move(priority_sessions_.front());
+          priority_sessions_.pop_front();
+          scheduled_time = p_session->NextScheduledPacketTime();
+          p_datagram = p_session->NextScheduledPacket();
+          if (IsDue(p_session, due_time)) {
+            // Round robin in the priority class
+            priority_sessions_.push_back(p_session);
+          } else {
+            Deactivate(p_session);
+          }
+        } else if (!active_sessions_.empty()) {
+          ActiveSession& active_session(active_sessions_.front());
+          if (active_session.deficit <= 0) {
+            // Turn of the session : add its quantum
+            active_session.deficit += Protocol::MTU *
+                                      std::max<uint32_t>(
+                                          1, active_session.p_session
+                                                 ->send_weight.load());
+          }
+          p_session = active_session.p_session;
+          scheduled_time = p_session->NextScheduledPacketTime();
+          p_datagram = p_session->NextScheduledPacket();
+          if (p_datagram) {
+            active_session.deficit -= p_datagram->payload().GetSize();
+          }
+          if (!IsDue(p_session, due_time)) {
+            active_sessions_.pop_front();
+            Deactivate(p_session);
+          } else if (active_session.deficit <= 0) {
+            // Quantum spent : next session
+            active_sessions_.push_back(std::move(active_session));
+            active_sessions_.pop_front();
+          }
+        } else {
+          break;
+        }
       }
 
-      typename SocketsContainer::iterator p_session_it;
-      p_session_it = socket_sessions_.begin();
-      p_session = *p_session_it;
-      socket_sessions_.erase(p_session_it);
+      if (p_datagram && p_session) {
+        if (Logger::ACTIVE) {
+          sent_count_ = sent_count_.load() + 1;
+          LogPacingError(scheduled_time);
+        }
+        p_session->QueueSendPacket(p_datagram, departure_horizon.count() > 0
+                                                   ? scheduled_time
+                                                   : TimePoint());
+      }
+    }
 
-      p_datagram = p_session->NextScheduledPacket();
+    PullSocketQueue();
+  }
+
+  /// Move the sessions due before due_time from the wheel to the round
+  /// robins, dropping stale entries, mutex_ held
+  void ActivateDueSessions(const TimePoint& due_time) {
+    Tick due_tick(ToTick(due_time));
+    ScheduledSession* p_front;
+    while ((p_front = socket_sessions_.Front(due_tick)) != nullptr) {
+      ScheduledSession scheduled_session(std::move(*p_front));
+      socket_sessions_.PopFront();
+      if (!IsLive(scheduled_session)) {
+        continue;
+      }
 
-      if (p_session->HasPacketToSend()) {
-        socket_sessions_.insert(p_session);
+      scheduled_sessions_[scheduled_session.p_session.get()].active = true;
+      typename SocketSession::Ptr p_session(
+          std::move(scheduled_session.p_session));
+      if (p_session->send_priority.load()) {
+        priority_sessions_.push_back(std::move(p_session));
+      } else {
+        ActiveSession active_session = {std::move(p_session), 0};
+        active_sessions_.push_back(std::move(active_session));
       }
     }
+  }
+
+  bool IsDue(const typename SocketSession::Ptr& p_session,
+             const TimePoint& due_time) {
+    return p_session->HasPacketToSend() &&
+           p_session->NextScheduledPacketTime() <= due_time;
+  }
 
-    if (p_datagram && p_session) {
-      if (Logger::ACTIVE) {
-        sent_count_ = sent_count_.load() + 1;
+  /// Send the session back to the wheel (or out of the flow if it has
+  /// nothing to send), mutex_ held
+  void Deactivate(const typename SocketSession::Ptr& p_session) {
+    if (!p_session->HasPacketToSend()) {
+      scheduled_sessions_.erase(p_session.get());
+      return;
+    }
+
+    InsertInWheel(p_session, ToTick(p_session->NextScheduledPacketTime()),
+                  &scheduled_sessions_[p_session.get()]);
+  }
+
+  /// Yield the last moments before the first session is due
+  void SpinUntilDue() {
+    if (spin_time_.count() <= 0) {
+      return;
+    }
+
+    TimePoint scheduled_time;
+    {
+      boost::mutex::scoped_lock lock_socket_sessions(mutex_);
+      if (!priority_sessions_.empty() || !active_sessions_.empty()) {
+        return;
+      }
+      ScheduledSession* p_front(
+          socket_sessions_.Front(ToTick(Clock::now() + spin_time_)));
+      if (p_front == nullptr || !IsLive(*p_front)) {
+        return;
       }
-      auto self = this->shared_from_this();
-      p_session->AsyncSendPacket(
-          p_datagram, [p_datagram](const boost::system::error_code& ec,
-                                   std::size_t length) {});
+      scheduled_time = p_front->p_session->NextScheduledPacketTime();
     }
 
-    PullSocketQueue();
+    if (scheduled_time - Clock::now() > spin_time_) {
+      return;
+    }
+    while (Clock::now() < scheduled_time) {
+      boost::this_thread::yield();
+    }
+  }
+
+  /// Record how late a packet left compared to its schedule
+  void LogPacingError(const TimePoint& scheduled_time) {
+    int64_t error(boost::chrono::duration_cast<boost::chrono::microseconds>(
+                      Clock::now() - scheduled_time)
+                      .count());
+    if (error < 0) {
+      error = 0;
+    }
+    pacing_error_sum_ = pacing_error_sum_.load() + error;
+    if (error > pacing_error_max_.load()) {
+      pacing_error_max_ = error;
+    }
   }
 
  private:
   boost::asio::io_service& io_service_;
 
+  // max packets pulled per wakeup
+  uint32_t max_batch_size_;
+
+  // end of waits spent yielding rather than on the timer
+  boost::chrono::microseconds spin_time_;
+
+  // micro seconds, kernel pacing when positive
+  std::atomic<int64_t> departure_horizon_;
+
   boost::mutex mutex_;
 
-  // sockets list
+  // sockets waiting for their next packet to be due
   SocketsContainer socket_sessions_;
+  // due sockets of the strict priority class, served first
+  std::deque<typename SocketSession::Ptr> priority_sessions_;
+  // due sockets served by deficit round robin, by weight
+  std::deque<ActiveSession> active_sessions_;
+  // sockets in one of the containers above, with their live wheel entry
+  std::unordered_map<SocketSession*, SessionSchedule> scheduled_sessions_;
+  // flow wide : entries of a session erased then scheduled again stay stale
+  uint64_t next_generation_;
 
   Timer next_packet_timer_;
 
   std::atomic<bool> pulling_;
 
+  congestion::SharedCongestionState::Ptr p_shared_congestion_state_;
+
   std::atomic<uint32_t> sent_count_;
+  // micro seconds between schedule and pull, catch-up bursts included
+  std::atomic<int64_t> pacing_error_sum_;
+  std::atomic<int64_t> pacing_error_max_;
 };
 
 }  // connected_protocol
@@ -5,6 +5,13 @@
 #pragma once
 #endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
 
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
 #include <boost/asio/buffer.hpp>
 
 namespace connected_protocol {
@@ -47,6 +54,127 @@ typedef fixed_buffer_sequence<boost::asio::mutable_buffer>
 typedef fixed_buffer_sequence<boost::asio::const_buffer>
     fixed_const_buffer_sequence;
 
+/// Buffer sequence of at most MaxBuffers buffers, without heap allocation
+/**
+* Used on the receive path, where a datagram is a header and a payload.
+* Buffers pushed beyond MaxBuffers are ignored.
+*/
+template <class BufferType, std::size_t MaxBuffers>
+class array_buffer_sequence {
+ public:
+  typedef std::array<BufferType, MaxBuffers> buffer_type;
+  typedef BufferType value_type;
+  typedef const BufferType* const_iterator;
+
+  array_buffer_sequence() : buffers_(), size_(0) {}
+
+  const_iterator begin() const { return buffers_.data(); }
+  const_iterator end() const { return buffers_.data() + size_; }
+
+  void push_back(const value_type& val) {
+    if (size_ < MaxBuffers) {
+      buffers_[size_++] = val;
+    }
+  }
+
+ private:
+  buffer_type buffers_;
+  std::size_t size_;
+};
+
+/// Header and payload views of a received datagram
+typedef array_buffer_sequence<boost::asio::mutable_buffer, 2>
+    datagram_mutable_buffers;
+
+typedef array_buffer_sequence<boost::asio::const_buffer, 2>
+    datagram_const_buffers;
+
+/// View of size bytes starting at offset in a buffer sequence (no copy)
+/**
+* @tparam Slice Buffer sequence holding the view
+*/
+template <class Slice = fixed_const_buffer_sequence,
+          class ConstBufferSequence>
+Slice SliceBuffers(const ConstBufferSequence& buffers, std::size_t offset,
+                   std::size_t size) {
+  Slice slice;
+  for (const auto& buffer : buffers) {
+    if (size == 0) {
+      break;
+    }
+    boost::asio::const_buffer current(buffer);
+    std::size_t buffer_size(boost::asio::buffer_size(current));
+    if (offset >= buffer_size) {
+      offset -= buffer_size;
+      continue;
+    }
+    current = current + offset;
+    offset = 0;
+    std::size_t taken(std::min(size, boost::asio::buffer_size(current)));
+    slice.push_back(boost::asio::buffer(current, taken));
+    size -= taken;
+  }
+
+  return slice;
+}
+
+/// Cursor over a buffer sequence, read out in chunks with memcpy
+/**
+* Packetizes a write one packet at a time : each Read copies as many bytes
+* as fit from the current position, crossing buffer boundaries.
+*/
+template <class ConstBufferSequence>
+class BufferSequenceReader {
+ public:
+  typedef typename ConstBufferSequence::const_iterator const_iterator;
+
+  explicit BufferSequenceReader(const ConstBufferSequence& buffers)
+      : current_it_(buffers.begin()), end_it_(buffers.end()), offset_(0) {
+    SkipEmptyBuffers();
+  }
+
+  /// @return true when the whole sequence was read
+  bool empty() const { return current_it_ == end_it_; }
+
+  /// Copy up to size bytes into p_data
+  /// @return number of bytes copied
+  std::size_t Read(void* p_data, std::size_t size) {
+    uint8_t* p_destination(static_cast<uint8_t*>(p_data));
+    std::size_t copied(0);
+    while (copied < size && current_it_ != end_it_) {
+      boost::asio::const_buffer current(*current_it_);
+      std::size_t buffer_size(boost::asio::buffer_size(current));
+      std::size_t length(std::min(size - copied, buffer_size - offset_));
+      std::memcpy(p_destination + copied,
+                  boost::asio::buffer_cast<const uint8_t*>(current) + offset_,
+                  length);
+      copied += length;
+      offset_ += length;
+      if (offset_ == buffer_size) {
+        ++current_it_;
+        offset_ = 0;
+        SkipEmptyBuffers();
+      }
+    }
+
+    return copied;
+  }
+
+ private:
+  void SkipEmptyBuffers() {
+    while (current_it_ != end_it_ &&
+           boost::asio::buffer_size(boost::asio::const_buffer(*current_it_)) ==
+               0) {
+      ++current_it_;
+    }
+  }
+
+ private:
+  const_iterator current_it_;
+  const_iterator end_it_;
+  std::size_t offset_;
+};
+
 }  // io
 }  // connected_protocol
 
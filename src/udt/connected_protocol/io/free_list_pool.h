@@ -0,0 +1,107 @@
+#ifndef UDT_CONNECTED_PROTOCOL_IO_FREE_LIST_POOL_H_
+#define UDT_CONNECTED_PROTOCOL_IO_FREE_LIST_POOL_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace connected_protocol {
+namespace io {
+
+/// Preallocated objects handed out and given back without heap allocation
+/**
+* Objects are allocated in chunks. When no object is free, a chunk as large
+* as the pool is added (counted as an exhaustion) : the pool doubles up to
+* the objects in use at once, with O(1) amortized growth.
+*
+* Acquire is called by one thread at a time (e.g. a receive chain or a
+* session write chain) and never locks. Release may be called from any
+* thread : released objects are pushed on a lock free stack, which Acquire
+* takes whole when its own free list is empty.
+*
+* The pool owns every object : acquired objects must be released before the
+* pool is destroyed, or are freed with it.
+*
+* @tparam T Default constructible class
+*/
+template <class T>
+class FreeListPool {
+ private:
+  struct Node : T {
+    Node() : T(), p_next_free(nullptr) {}
+
+    Node* p_next_free;
+  };
+
+ public:
+  explicit FreeListPool(std::size_t capacity)
+      : chunks_(),
+        size_(0),
+        p_free_(nullptr),
+        p_released_(nullptr),
+        exhausted_count_(0) {
+    Grow(capacity > 0 ? capacity : 1);
+  }
+
+  T* Acquire() {
+    if (p_free_ == nullptr) {
+      p_free_ = p_released_.exchange(nullptr, std::memory_order_acquire);
+    }
+    if (p_free_ == nullptr) {
+      exhausted_count_ = exhausted_count_.load() + 1;
+      Grow(size_);
+    }
+
+    Node* p_node = p_free_;
+    p_free_ = p_node->p_next_free;
+    return p_node;
+  }
+
+  void Release(T* p_object) {
+    Node* p_node = static_cast<Node*>(p_object);
+    Node* p_head = p_released_.load(std::memory_order_relaxed);
+    do {
+      p_node->p_next_free = p_head;
+    } while (!p_released_.compare_exchange_weak(p_head, p_node,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+  }
+
+  /// @return number of Acquire calls which found no free object
+  uint32_t exhausted_count() const { return exhausted_count_.load(); }
+
+  void reset_exhausted_count() { exhausted_count_ = 0; }
+
+ private:
+  /// Add a chunk of objects to the free list, Acquire side
+  void Grow(std::size_t count) {
+    std::unique_ptr<Node[]> p_chunk(new Node[count]);
+    for (std::size_t i = 0; i < count; ++i) {
+      p_chunk[i].p_next_free = i + 1 < count ? &p_chunk[i + 1] : p_free_;
+    }
+    p_free_ = &p_chunk[0];
+    chunks_.push_back(std::move(p_chunk));
+    size_ += count;
+  }
+
+ private:
+  std::vector<std::unique_ptr<Node[]>> chunks_;
+  // objects in the chunks
+  std::size_t size_;
+  // free objects only seen by Acquire
+  Node* p_free_;
+  // objects released since Acquire last took them
+  std::atomic<Node*> p_released_;
+  std::atomic<uint32_t> exhausted_count_;
+};
+
+}  // io
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_IO_FREE_LIST_POOL_H_
@@ -0,0 +1,188 @@
+#ifndef UDT_CONNECTED_PROTOCOL_IO_RECEIVE_BATCH_H_
+#define UDT_CONNECTED_PROTOCOL_IO_RECEIVE_BATCH_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstdint>
+
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/system/error_code.hpp>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif  // defined(__linux__)
+
+#include "udt/connected_protocol/io/receive_timestamp.h"
+#include "udt/connected_protocol/io/udp_offload.h"
+
+namespace connected_protocol {
+namespace io {
+
+/// Preallocated datagram slots filled by a single recvmmsg call
+/**
+* A coalesced batch also reads the UDP_GRO control message : a slot may then
+* hold several datagrams of segment_size bytes (the last one may be shorter).
+* A timestamped batch reads the SO_TIMESTAMPNS control message.
+*
+* @tparam Datagram The receive datagram type (header + fixed size payload)
+* @tparam Endpoint The next layer endpoint type
+*/
+template <class Datagram, class Endpoint>
+class ReceiveBatch {
+ public:
+#if defined(__linux__)
+  enum : bool { SUPPORTED = true };
+#else
+  enum : bool { SUPPORTED = false };
+#endif  // defined(__linux__)
+
+ public:
+  /**
+  * @param capacity Number of slots
+  * @param coalesced Read GRO segment sizes
+  * @param timestamped Read kernel receive timestamps
+  */
+  explicit ReceiveBatch(std::size_t capacity, bool coalesced = false,
+                        bool timestamped = false)
+      : datagrams_(capacity),
+        endpoints_(capacity),
+        lengths_(capacity, 0),
+        segment_sizes_(capacity, 0),
+        arrival_times_(capacity)
+#if defined(__linux__)
+        ,
+        iovecs_(),
+        headers_(capacity),
+        controls_((coalesced || timestamped) ? capacity : 0),
+        timestamp_converter_()
+#endif  // defined(__linux__)
+  {
+#if defined(__linux__)
+    for (std::size_t i = 0; i < capacity; ++i) {
+      auto& payload = datagrams_[i].payload();
+      payload.SetOffset(0);
+      payload.SetSize(Datagram::Payload::size);
+      for (const auto& buffer : datagrams_[i].GetMutableBuffers()) {
+        struct iovec vec;
+        vec.iov_base = boost::asio::buffer_cast<void*>(buffer);
+        vec.iov_len = boost::asio::buffer_size(buffer);
+        iovecs_.push_back(vec);
+      }
+    }
+    std::size_t iovecs_per_datagram = capacity ? iovecs_.size() / capacity : 0;
+    for (std::size_t i = 0; i < capacity; ++i) {
+      struct msghdr& msg = headers_[i].msg_hdr;
+      msg.msg_iov = &iovecs_[i * iovecs_per_datagram];
+      msg.msg_iovlen = iovecs_per_datagram;
+      msg.msg_control = nullptr;
+      msg.msg_controllen = 0;
+      msg.msg_flags = 0;
+    }
+#endif  // defined(__linux__)
+  }
+
+  /// Drain pending datagrams without blocking
+  /**
+  * @param native_socket The non blocking UDP socket descriptor
+  * @param ec Set on socket error, would_block is not an error
+  * @return number of slots filled
+  */
+  std::size_t Receive(int native_socket, boost::system::error_code& ec) {
+    ec.clear();
+#if defined(__linux__)
+    for (std::size_t i = 0; i < headers_.size(); ++i) {
+      struct msghdr& msg = headers_[i].msg_hdr;
+      msg.msg_name = endpoints_[i].data();
+      msg.msg_namelen = static_cast<socklen_t>(endpoints_[i].capacity());
+      if (!controls_.empty()) {
+        // Kernel shrinks msg_controllen to the received control data
+        msg.msg_control = controls_[i].buffer;
+        msg.msg_controllen = sizeof(controls_[i].buffer);
+      }
+      headers_[i].msg_len = 0;
+    }
+
+    int result;
+    do {
+      result = ::recvmmsg(native_socket, headers_.data(),
+                          static_cast<unsigned int>(headers_.size()),
+                          MSG_DONTWAIT, nullptr);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        ec.assign(errno, boost::system::system_category());
+      }
+      return 0;
+    }
+
+    if (!controls_.empty()) {
+      timestamp_converter_.Sync();
+    }
+    for (int i = 0; i < result; ++i) {
+      endpoints_[i].resize(headers_[i].msg_hdr.msg_namelen);
+      lengths_[i] = headers_[i].msg_len;
+      segment_sizes_[i] = GetGroSegmentSize(headers_[i].msg_hdr);
+      arrival_times_[i] =
+          timestamp_converter_.GetArrivalTime(headers_[i].msg_hdr);
+    }
+
+    return static_cast<std::size_t>(result);
+#else
+    ec.assign(boost::system::errc::function_not_supported,
+              boost::system::generic_category());
+    return 0;
+#endif  // defined(__linux__)
+  }
+
+  std::size_t capacity() const { return datagrams_.size(); }
+
+  Datagram& datagram(std::size_t index) { return datagrams_[index]; }
+
+  Endpoint& endpoint(std::size_t index) { return endpoints_[index]; }
+
+  /// @return received bytes (header included) of the slot
+  std::size_t length(std::size_t index) const { return lengths_[index]; }
+
+  /// @return size of the datagrams coalesced in the slot, 0 if not coalesced
+  std::size_t segment_size(std::size_t index) const {
+    return segment_sizes_[index];
+  }
+
+  /// @return kernel arrival time of the slot, unset if not timestamped
+  const ArrivalTimePoint& arrival_time(std::size_t index) const {
+    return arrival_times_[index];
+  }
+
+ private:
+#if defined(__linux__)
+  union Control {
+    char buffer[GRO_CONTROL_SIZE + TIMESTAMP_CONTROL_SIZE];
+    struct cmsghdr align;
+  };
+#endif  // defined(__linux__)
+
+ private:
+  std::vector<Datagram> datagrams_;
+  std::vector<Endpoint> endpoints_;
+  std::vector<std::size_t> lengths_;
+  std::vector<std::size_t> segment_sizes_;
+  std::vector<ArrivalTimePoint> arrival_times_;
+#if defined(__linux__)
+  std::vector<struct iovec> iovecs_;
+  std::vector<struct mmsghdr> headers_;
+  std::vector<Control> controls_;
+  ReceiveTimestampConverter timestamp_converter_;
+#endif  // defined(__linux__)
+};
+
+}  // io
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_IO_RECEIVE_BATCH_H_
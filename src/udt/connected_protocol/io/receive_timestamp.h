@@ -0,0 +1,115 @@
+#ifndef UDT_CONNECTED_PROTOCOL_IO_RECEIVE_TIMESTAMP_H_
+#define UDT_CONNECTED_PROTOCOL_IO_RECEIVE_TIMESTAMP_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <boost/chrono.hpp>
+#include <boost/system/error_code.hpp>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <time.h>
+#endif  // defined(__linux__)
+
+namespace connected_protocol {
+namespace io {
+
+/// Clock of the datagram arrival times handed to sessions
+typedef boost::chrono::high_resolution_clock ArrivalClock;
+/// Unset (epoch) when the kernel gave no timestamp
+typedef ArrivalClock::time_point ArrivalTimePoint;
+
+/// Ask the kernel to timestamp received datagrams (SO_TIMESTAMPNS)
+/**
+* Datagrams are stamped when the kernel receives them, before queuing. Reads
+* must then provide a control buffer : see ReceiveTimestampConverter.
+*
+* @param native_socket The UDP socket descriptor
+* @param ec Set if the kernel does not support SO_TIMESTAMPNS
+*/
+inline void EnableReceiveTimestamps(int native_socket,
+                                    boost::system::error_code& ec) {
+  ec.clear();
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+  int enable(1);
+  if (::setsockopt(native_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable,
+                   sizeof(enable)) < 0) {
+    ec.assign(errno, boost::system::system_category());
+  }
+#else
+  (void)native_socket;
+  ec.assign(boost::system::errc::function_not_supported,
+            boost::system::generic_category());
+#endif  // defined(__linux__) && defined(SO_TIMESTAMPNS)
+}
+
+#if defined(__linux__)
+/// Space needed in a control buffer to receive the timestamp
+enum : std::size_t {
+  TIMESTAMP_CONTROL_SIZE = CMSG_SPACE(sizeof(struct timespec))
+};
+
+/// Convert kernel timestamps (CLOCK_REALTIME) to ArrivalClock
+/**
+* The offset between both clocks is read once per receive wakeup : datagrams
+* of a batch keep their exact intervals.
+*/
+class ReceiveTimestampConverter {
+ public:
+  ReceiveTimestampConverter() : offset_(0) {}
+
+  /// Read the offset between the kernel clock and ArrivalClock
+  void Sync() {
+    struct timespec realtime_now;
+    ::clock_gettime(CLOCK_REALTIME, &realtime_now);
+    offset_ = ArrivalClock::now().time_since_epoch() - ToDuration(realtime_now);
+  }
+
+  /**
+  * @param msg The message header filled by recvmsg/recvmmsg
+  * @return the arrival time, unset if the read carries no timestamp
+  */
+  ArrivalTimePoint GetArrivalTime(const struct msghdr& msg) const {
+    if (msg.msg_control == nullptr) {
+      return ArrivalTimePoint();
+    }
+
+    for (const struct cmsghdr* p_cmsg =
+             CMSG_FIRSTHDR(const_cast<struct msghdr*>(&msg));
+         p_cmsg != nullptr;
+         p_cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg),
+                              const_cast<struct cmsghdr*>(p_cmsg))) {
+      if (p_cmsg->cmsg_level == SOL_SOCKET &&
+          p_cmsg->cmsg_type == SCM_TIMESTAMPNS &&
+          p_cmsg->cmsg_len >= CMSG_LEN(sizeof(struct timespec))) {
+        struct timespec timestamp;
+        std::memcpy(&timestamp, CMSG_DATA(p_cmsg), sizeof(timestamp));
+        return ArrivalTimePoint(ToDuration(timestamp) + offset_);
+      }
+    }
+
+    return ArrivalTimePoint();
+  }
+
+ private:
+  static ArrivalClock::duration ToDuration(const struct timespec& time) {
+    return boost::chrono::duration_cast<ArrivalClock::duration>(
+        boost::chrono::seconds(time.tv_sec) +
+        boost::chrono::nanoseconds(time.tv_nsec));
+  }
+
+ private:
+  ArrivalClock::duration offset_;
+};
+#endif  // defined(__linux__)
+
+}  // io
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_IO_RECEIVE_TIMESTAMP_H_
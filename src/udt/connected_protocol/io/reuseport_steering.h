@@ -0,0 +1,67 @@
+#ifndef UDT_CONNECTED_PROTOCOL_IO_REUSEPORT_STEERING_H_
+#define UDT_CONNECTED_PROTOCOL_IO_REUSEPORT_STEERING_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstdint>
+
+#include <boost/system/error_code.hpp>
+
+#if defined(__linux__)
+#include <linux/filter.h>
+#include <sys/socket.h>
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif  // SO_ATTACH_REUSEPORT_CBPF
+#endif  // defined(__linux__)
+
+namespace connected_protocol {
+namespace io {
+
+/// Steer datagrams of a SO_REUSEPORT group on their UDT destination socket id
+/**
+* The classic BPF program loads the 32 bits socket id at offset 12 of the UDT
+* header (the kernel has already pulled the UDP header) and selects socket
+* (id % shards_count) of the group, in bind order. Id 0 (connection
+* requests) selects no socket : the kernel falls back to its 4-tuple hash.
+*
+* @param native_socket Any UDP socket of the reuseport group
+* @param shards_count Number of sockets in the group
+* @param ec Set if the program could not be attached
+*/
+inline void AttachSocketIdSteering(int native_socket, uint32_t shards_count,
+                                   boost::system::error_code& ec) {
+  ec.clear();
+#if defined(__linux__)
+  struct sock_filter code[] = {
+      // A = ntohl(*(uint32_t*)(payload + 12))
+      BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 12),
+      // Unknown destination : return an invalid index
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 1),
+      BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF),
+      // A = A % shards_count
+      BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, shards_count),
+      BPF_STMT(BPF_RET | BPF_A, 0)};
+
+  struct sock_fprog program;
+  program.len = sizeof(code) / sizeof(code[0]);
+  program.filter = code;
+
+  if (::setsockopt(native_socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                   &program, sizeof(program)) < 0) {
+    ec.assign(errno, boost::system::system_category());
+  }
+#else
+  ec.assign(boost::system::errc::function_not_supported,
+            boost::system::generic_category());
+#endif  // defined(__linux__)
+}
+
+}  // io
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_IO_REUSEPORT_STEERING_H_
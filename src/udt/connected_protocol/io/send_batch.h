@@ -0,0 +1,325 @@
+#ifndef UDT_CONNECTED_PROTOCOL_IO_SEND_BATCH_H_
+#define UDT_CONNECTED_PROTOCOL_IO_SEND_BATCH_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/system/error_code.hpp>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif  // defined(__linux__)
+
+#include "udt/connected_protocol/io/tx_time.h"
+#include "udt/connected_protocol/io/udp_offload.h"
+
+namespace connected_protocol {
+namespace io {
+
+/// Datagrams gathered to be sent with a single sendmmsg call
+/**
+* The batch does not own the datagrams, they must stay alive until Send
+* returns.
+*
+* With GSO enabled, consecutive datagrams of the same size going to the same
+* endpoint are coalesced in one message carrying an UDP_SEGMENT control
+* message : the kernel (or the NIC) splits it back into datagrams.
+*
+* With tx time enabled, datagrams given a departure time carry a SCM_TXTIME
+* control message. Only datagrams with the same departure time are coalesced.
+*
+* @tparam Datagram The send datagram type
+* @tparam Endpoint The next layer endpoint type
+*/
+template <class Datagram, class Endpoint>
+class SendBatch {
+ public:
+#if defined(__linux__)
+  enum : bool { SUPPORTED = true };
+#else
+  enum : bool { SUPPORTED = false };
+#endif  // defined(__linux__)
+
+  enum : std::size_t {
+    MAX_BUFFERS_PER_DATAGRAM = 4,
+    MAX_GSO_SEGMENTS = 64,
+    MAX_GSO_BYTES = 65507
+  };
+
+ public:
+  explicit SendBatch(std::size_t capacity)
+      : capacity_(capacity),
+        gso_(false),
+        tx_time_(false),
+        datagrams_(),
+        endpoints_(),
+        tx_times_()
+#if defined(__linux__)
+        ,
+        sizes_(),
+        iovec_offsets_(),
+        iovecs_(capacity * MAX_BUFFERS_PER_DATAGRAM),
+        headers_(capacity),
+        message_counts_(capacity),
+        controls_(capacity)
+#endif  // defined(__linux__)
+  {
+    datagrams_.reserve(capacity);
+    endpoints_.reserve(capacity);
+    tx_times_.reserve(capacity);
+#if defined(__linux__)
+    sizes_.reserve(capacity);
+    iovec_offsets_.reserve(capacity + 1);
+#endif  // defined(__linux__)
+  }
+
+  void set_gso(bool gso) { gso_ = gso; }
+
+  bool gso() const { return gso_; }
+
+  /// Requires SO_TXTIME on the socket : see EnableTxTime
+  void set_tx_time(bool tx_time) { tx_time_ = tx_time; }
+
+  bool tx_time() const { return tx_time_; }
+
+  /**
+  * @param tx_time Earliest departure time in kernel nanoseconds, 0 to send
+  *   as soon as possible
+  * @return false if the batch is full
+  */
+  bool Add(Datagram* p_datagram, const Endpoint& endpoint,
+           uint64_t tx_time = 0) {
+    if (full()) {
+      return false;
+    }
+
+    datagrams_.push_back(p_datagram);
+    endpoints_.push_back(endpoint);
+    tx_times_.push_back(tx_time);
+    return true;
+  }
+
+  /// Send gathered datagrams without blocking
+  /**
+  * A GSO send rejected by the kernel disables GSO on the batch and the
+  * remaining datagrams are sent one message each. A rejected departure time
+  * disables tx time the same way.
+  *
+  * @param native_socket The UDP socket descriptor
+  * @param ec Set on socket error, would_block is not an error
+  * @return number of datagrams sent, starting from the first one
+  */
+  std::size_t Send(int native_socket, boost::system::error_code& ec) {
+    ec.clear();
+#if defined(__linux__)
+    std::size_t sent(0);
+    while (sent < datagrams_.size()) {
+      std::size_t messages(BuildMessages(sent));
+      std::size_t sent_messages(0);
+      int error(0);
+
+      while (sent_messages < messages) {
+        int result = ::sendmmsg(native_socket, &headers_[sent_messages],
+                                static_cast<unsigned int>(messages -
+                                                          sent_messages),
+                                MSG_DONTWAIT);
+        if (result < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          error = errno;
+          break;
+        }
+        for (int i = 0; i < result; ++i) {
+          sent += message_counts_[sent_messages + i];
+        }
+        sent_messages += static_cast<std::size_t>(result);
+      }
+
+      if (error == 0) {
+        continue;
+      }
+
+      if (gso_ && message_counts_[sent_messages] > 1 &&
+          (error == EIO || error == EINVAL || error == ENOPROTOOPT ||
+           error == EMSGSIZE)) {
+        // Segmentation offload rejected : send without it from now on
+        gso_ = false;
+        continue;
+      }
+
+      if (tx_time_ && tx_times_[sent] != 0 &&
+          (error == EINVAL || error == ENOPROTOOPT || error == EOPNOTSUPP)) {
+        // Departure time rejected : send on schedule from now on
+        tx_time_ = false;
+        continue;
+      }
+
+      if (error != EAGAIN && error != EWOULDBLOCK) {
+        ec.assign(error, boost::system::system_category());
+      }
+      break;
+    }
+
+    return sent;
+#else
+    ec.assign(boost::system::errc::function_not_supported,
+              boost::system::generic_category());
+    return 0;
+#endif  // defined(__linux__)
+  }
+
+  void Clear() {
+    datagrams_.clear();
+    endpoints_.clear();
+    tx_times_.clear();
+  }
+
+  bool empty() const { return datagrams_.empty(); }
+
+  bool full() const { return datagrams_.size() >= capacity_; }
+
+  std::size_t size() const { return datagrams_.size(); }
+
+  Datagram* datagram(std::size_t index) { return datagrams_[index]; }
+
+  const Endpoint& endpoint(std::size_t index) const {
+    return endpoints_[index];
+  }
+
+ private:
+#if defined(__linux__)
+  union Control {
+    char buffer[CMSG_SPACE(sizeof(uint16_t)) + TX_TIME_CONTROL_SIZE];
+    struct cmsghdr align;
+  };
+
+  /// Fill iovecs and messages for datagrams starting at first
+  /// @return number of messages
+  std::size_t BuildMessages(std::size_t first) {
+    std::size_t count(datagrams_.size());
+    std::size_t iovecs_count(0);
+    sizes_.clear();
+    iovec_offsets_.clear();
+
+    for (std::size_t i = first; i < count; ++i) {
+      iovec_offsets_.push_back(iovecs_count);
+      std::size_t datagram_size(0);
+      std::size_t datagram_iovecs(0);
+      for (const auto& buffer : datagrams_[i]->GetConstBuffers()) {
+        if (datagram_iovecs == MAX_BUFFERS_PER_DATAGRAM) {
+          break;
+        }
+        struct iovec& vec = iovecs_[iovecs_count];
+        vec.iov_base =
+            const_cast<void*>(boost::asio::buffer_cast<const void*>(buffer));
+        vec.iov_len = boost::asio::buffer_size(buffer);
+        datagram_size += vec.iov_len;
+        ++datagram_iovecs;
+        ++iovecs_count;
+      }
+      sizes_.push_back(datagram_size);
+    }
+    iovec_offsets_.push_back(iovecs_count);
+
+    std::size_t messages(0);
+    std::size_t i(first);
+    while (i < count) {
+      std::size_t segment_size(sizes_[i - first]);
+      std::size_t segments(1);
+      std::size_t total_size(segment_size);
+
+      if (gso_ && segment_size > 0) {
+        while (i + segments < count && segments < MAX_GSO_SEGMENTS) {
+          std::size_t next_size(sizes_[i + segments - first]);
+          if (!(endpoints_[i + segments] == endpoints_[i]) ||
+              (tx_time_ && tx_times_[i + segments] != tx_times_[i]) ||
+              next_size > segment_size || next_size == 0 ||
+              total_size + next_size > MAX_GSO_BYTES) {
+            break;
+          }
+          total_size += next_size;
+          ++segments;
+          if (next_size < segment_size) {
+            // A shorter segment can only be the last one
+            break;
+          }
+        }
+      }
+
+      struct msghdr& msg = headers_[messages].msg_hdr;
+      std::memset(&msg, 0, sizeof(msg));
+      msg.msg_name = endpoints_[i].data();
+      msg.msg_namelen = static_cast<socklen_t>(endpoints_[i].size());
+      msg.msg_iov = &iovecs_[iovec_offsets_[i - first]];
+      msg.msg_iovlen =
+          iovec_offsets_[i - first + segments] - iovec_offsets_[i - first];
+
+      bool stamped(tx_time_ && tx_times_[i] != 0);
+      if (segments > 1 || stamped) {
+        msg.msg_control = controls_[messages].buffer;
+        msg.msg_controllen = sizeof(controls_[messages].buffer);
+        std::memset(controls_[messages].buffer, 0,
+                    sizeof(controls_[messages].buffer));
+        struct cmsghdr* p_cmsg = CMSG_FIRSTHDR(&msg);
+        std::size_t control_length(0);
+        if (segments > 1) {
+          p_cmsg->cmsg_level = SOL_UDP;
+          p_cmsg->cmsg_type = UDP_SEGMENT;
+          p_cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+          uint16_t gso_size(static_cast<uint16_t>(segment_size));
+          std::memcpy(CMSG_DATA(p_cmsg), &gso_size, sizeof(gso_size));
+          control_length += CMSG_SPACE(sizeof(uint16_t));
+          p_cmsg = CMSG_NXTHDR(&msg, p_cmsg);
+        }
+        if (stamped) {
+          p_cmsg->cmsg_level = SOL_SOCKET;
+          p_cmsg->cmsg_type = SCM_TXTIME;
+          p_cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+          std::memcpy(CMSG_DATA(p_cmsg), &tx_times_[i], sizeof(uint64_t));
+          control_length += TX_TIME_CONTROL_SIZE;
+        }
+        msg.msg_controllen = control_length;
+      }
+
+      headers_[messages].msg_len = 0;
+      message_counts_[messages] = segments;
+      ++messages;
+      i += segments;
+    }
+
+    return messages;
+  }
+#endif  // defined(__linux__)
+
+ private:
+  std::size_t capacity_;
+  bool gso_;
+  bool tx_time_;
+  std::vector<Datagram*> datagrams_;
+  std::vector<Endpoint> endpoints_;
+  /// Departure times in kernel nanoseconds, 0 when unset
+  std::vector<uint64_t> tx_times_;
+#if defined(__linux__)
+  std::vector<std::size_t> sizes_;
+  std::vector<std::size_t> iovec_offsets_;
+  std::vector<struct iovec> iovecs_;
+  std::vector<struct mmsghdr> headers_;
+  std::vector<std::size_t> message_counts_;
+  std::vector<Control> controls_;
+#endif  // defined(__linux__)
+};
+
+}  // io
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_IO_SEND_BATCH_H_
@@ -0,0 +1,109 @@
+#ifndef UDT_CONNECTED_PROTOCOL_IO_TX_TIME_H_
+#define UDT_CONNECTED_PROTOCOL_IO_TX_TIME_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <boost/chrono.hpp>
+#include <boost/system/error_code.hpp>
+
+#if defined(__linux__)
+#include <linux/net_tstamp.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+#endif  // SO_TXTIME
+
+#ifndef SCM_TXTIME
+#define SCM_TXTIME SO_TXTIME
+#endif  // SCM_TXTIME
+#endif  // defined(__linux__)
+
+namespace connected_protocol {
+namespace io {
+
+/// Clock of the departure times given to the multiplexer
+typedef boost::chrono::high_resolution_clock DepartureClock;
+/// Unset (epoch) to send as soon as possible
+typedef DepartureClock::time_point DepartureTimePoint;
+
+/// Let sends carry an earliest departure time (SO_TXTIME)
+/**
+* The fq qdisc holds each stamped datagram until its departure time, packets
+* can then be handed to the kernel ahead of schedule. Without fq (or etf) on
+* the egress interface, stamps are ignored and packets leave on send.
+*
+* @param native_socket The UDP socket descriptor
+* @param ec Set if the kernel does not support SO_TXTIME
+*/
+inline void EnableTxTime(int native_socket, boost::system::error_code& ec) {
+  ec.clear();
+#if defined(__linux__)
+  struct sock_txtime config;
+  std::memset(&config, 0, sizeof(config));
+  config.clockid = CLOCK_MONOTONIC;
+  config.flags = 0;
+  if (::setsockopt(native_socket, SOL_SOCKET, SO_TXTIME, &config,
+                   sizeof(config)) < 0) {
+    ec.assign(errno, boost::system::system_category());
+  }
+#else
+  (void)native_socket;
+  ec.assign(boost::system::errc::function_not_supported,
+            boost::system::generic_category());
+#endif  // defined(__linux__)
+}
+
+#if defined(__linux__)
+/// Space needed in a control buffer to send a departure time
+enum : std::size_t { TX_TIME_CONTROL_SIZE = CMSG_SPACE(sizeof(uint64_t)) };
+#endif  // defined(__linux__)
+
+/// Convert departure times to the kernel clock (CLOCK_MONOTONIC nanoseconds)
+/**
+* The offset between both clocks is read once per send batch.
+*/
+class TxTimeConverter {
+ public:
+  TxTimeConverter() : offset_(0) {}
+
+  /// Read the offset between DepartureClock and the kernel clock
+  void Sync() {
+#if defined(__linux__)
+    struct timespec monotonic_now;
+    ::clock_gettime(CLOCK_MONOTONIC, &monotonic_now);
+    offset_ = boost::chrono::seconds(monotonic_now.tv_sec) +
+              boost::chrono::nanoseconds(monotonic_now.tv_nsec) -
+              boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+                  DepartureClock::now().time_since_epoch());
+#endif  // defined(__linux__)
+  }
+
+  /// @return the departure time in kernel nanoseconds, 0 if unset
+  uint64_t GetTxTime(const DepartureTimePoint& departure_time) const {
+    if (departure_time == DepartureTimePoint()) {
+      return 0;
+    }
+
+    boost::chrono::nanoseconds tx_time(
+        boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+            departure_time.time_since_epoch()) +
+        offset_);
+    return tx_time.count() > 0 ? static_cast<uint64_t>(tx_time.count()) : 0;
+  }
+
+ private:
+  boost::chrono::nanoseconds offset_;
+};
+
+}  // io
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_IO_TX_TIME_H_
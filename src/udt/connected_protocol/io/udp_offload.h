@@ -0,0 +1,112 @@
+#ifndef UDT_CONNECTED_PROTOCOL_IO_UDP_OFFLOAD_H_
+#define UDT_CONNECTED_PROTOCOL_IO_UDP_OFFLOAD_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <boost/system/error_code.hpp>
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif  // SOL_UDP
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif  // UDP_SEGMENT
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif  // UDP_GRO
+#endif  // defined(__linux__)
+
+namespace connected_protocol {
+namespace io {
+
+/// Check if the socket accepts UDP_SEGMENT (GSO) control messages
+inline bool IsGsoSupported(int native_socket) {
+#if defined(__linux__)
+  int gso_size(0);
+  socklen_t option_length(sizeof(gso_size));
+  return ::getsockopt(native_socket, SOL_UDP, UDP_SEGMENT, &gso_size,
+                      &option_length) == 0;
+#else
+  return false;
+#endif  // defined(__linux__)
+}
+
+/// Let the kernel coalesce received datagrams of a peer (UDP_GRO)
+/**
+* Once enabled, reads must provide a control buffer to get the segment size
+* back : see GetGroSegmentSize.
+*
+* @param native_socket The UDP socket descriptor
+* @param ec Set if the kernel does not support UDP_GRO
+*/
+inline void EnableGro(int native_socket, boost::system::error_code& ec) {
+  ec.clear();
+#if defined(__linux__)
+  int enable(1);
+  if (::setsockopt(native_socket, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) <
+      0) {
+    ec.assign(errno, boost::system::system_category());
+  }
+#else
+  ec.assign(boost::system::errc::function_not_supported,
+            boost::system::generic_category());
+#endif  // defined(__linux__)
+}
+
+#if defined(__linux__)
+/// Space needed in a control buffer to receive the GRO segment size
+enum : std::size_t { GRO_CONTROL_SIZE = CMSG_SPACE(sizeof(int)) };
+
+/// Extract the segment size of a coalesced read
+/**
+* @param msg The message header filled by recvmsg/recvmmsg
+* @return the size of each segment (the last one may be shorter), 0 if the
+*   read holds a single datagram
+*/
+inline std::size_t GetGroSegmentSize(const struct msghdr& msg) {
+  if (msg.msg_control == nullptr) {
+    return 0;
+  }
+
+  for (const struct cmsghdr* p_cmsg =
+           CMSG_FIRSTHDR(const_cast<struct msghdr*>(&msg));
+       p_cmsg != nullptr;
+       p_cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg),
+                            const_cast<struct cmsghdr*>(p_cmsg))) {
+    if (p_cmsg->cmsg_level != SOL_UDP || p_cmsg->cmsg_type != UDP_GRO) {
+      continue;
+    }
+
+    if (p_cmsg->cmsg_len >= CMSG_LEN(sizeof(int))) {
+      int gso_size(0);
+      std::memcpy(&gso_size, CMSG_DATA(p_cmsg), sizeof(gso_size));
+      return gso_size > 0 ? static_cast<std::size_t>(gso_size) : 0;
+    }
+
+    if (p_cmsg->cmsg_len >= CMSG_LEN(sizeof(uint16_t))) {
+      uint16_t gso_size(0);
+      std::memcpy(&gso_size, CMSG_DATA(p_cmsg), sizeof(gso_size));
+      return gso_size;
+    }
+  }
+
+  return 0;
+}
+#endif  // defined(__linux__)
+
+}  // io
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_IO_UDP_OFFLOAD_H_
@@ -0,0 +1,497 @@
+#ifndef UDT_CONNECTED_PROTOCOL_IO_URING_RECEIVER_H_
+#define UDT_CONNECTED_PROTOCOL_IO_URING_RECEIVER_H_
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif  // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif  // __has_include(<linux/io_uring.h>)
+#endif  // defined(__linux__) && defined(__has_include)
+
+// Multishot recvmsg and provided buffer rings (Linux 6.0)
+#if defined(IORING_RECV_MULTISHOT)
+#define UDT_IO_URING_RECEIVE 1
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // defined(IORING_RECV_MULTISHOT)
+
+#include "udt/connected_protocol/io/receive_timestamp.h"
+#include "udt/connected_protocol/io/udp_offload.h"
+
+namespace connected_protocol {
+namespace io {
+
+/// Datagrams received through io_uring multishot recvmsg
+/**
+* A single recvmsg request stays armed on the UDP socket and completes once
+* per datagram, in a buffer picked by the kernel from a provided buffer
+* ring. Buffers are given back to the ring as soon as the datagram has been
+* dispatched. Completions are signaled on an eventfd waited on by the
+* io_service, so the socket itself is never polled.
+*
+* Waits and drains run on the receive loop : the receiver is not thread
+* safe.
+*
+* @tparam Endpoint The next layer endpoint type
+*/
+template <class Endpoint>
+class UringReceiver {
+ public:
+#if defined(UDT_IO_URING_RECEIVE)
+  enum : bool { SUPPORTED = true };
+#else
+  enum : bool { SUPPORTED = false };
+#endif  // defined(UDT_IO_URING_RECEIVE)
+
+ public:
+  /**
+  * @param io_service Service running the completion waits
+  * @param buffers_count Number of provided buffers (rounded up to a power
+  *   of 2), i.e. datagrams the kernel can queue before dispatch
+  * @param datagram_size Largest datagram (or GRO coalesced datagram) read
+  * @param coalesced Read GRO segment sizes
+  * @param timestamped Read kernel receive timestamps
+  */
+  UringReceiver(boost::asio::io_service& io_service, std::size_t buffers_count,
+                std::size_t datagram_size, bool coalesced = false,
+                bool timestamped = false)
+      : buffers_count_(RoundUpPowerOfTwo(buffers_count)),
+        buffer_size_(0),
+        buffers_(),
+        native_socket_(-1),
+        ring_fd_(-1),
+        endpoint_()
+#if defined(UDT_IO_URING_RECEIVE)
+        ,
+        event_descriptor_(io_service),
+        event_count_(0),
+        msg_(),
+        timestamp_converter_(),
+        p_sq_ring_(nullptr),
+        sq_ring_size_(0),
+        p_cq_ring_(nullptr),
+        cq_ring_size_(0),
+        p_sqes_(nullptr),
+        sqes_size_(0),
+        p_sq_tail_(nullptr),
+        p_sq_array_(nullptr),
+        sq_mask_(0),
+        p_cq_head_(nullptr),
+        p_cq_tail_(nullptr),
+        p_cqes_(nullptr),
+        cq_mask_(0),
+        p_buf_ring_(nullptr),
+        buf_ring_size_(0),
+        buf_ring_tail_(0)
+#endif  // defined(UDT_IO_URING_RECEIVE)
+  {
+#if defined(UDT_IO_URING_RECEIVE)
+    std::memset(&msg_, 0, sizeof(msg_));
+    msg_.msg_namelen = sizeof(struct sockaddr_in6);
+    msg_.msg_controllen = (coalesced ? GRO_CONTROL_SIZE : 0) +
+                          (timestamped ? TIMESTAMP_CONTROL_SIZE : 0);
+    buffer_size_ = sizeof(struct io_uring_recvmsg_out) + msg_.msg_namelen +
+                   msg_.msg_controllen + datagram_size;
+    buffers_.resize(buffers_count_ * buffer_size_);
+#else
+    (void)io_service;
+    (void)datagram_size;
+    (void)coalesced;
+    (void)timestamped;
+#endif  // defined(UDT_IO_URING_RECEIVE)
+  }
+
+  ~UringReceiver() { Close(); }
+
+  /// Create the ring and arm the multishot receive on the socket
+  /**
+  * @param native_socket The bound UDP socket descriptor
+  * @param ec Set if the kernel does not support the requests, the receiver
+  *   is then closed
+  */
+  void Open(int native_socket, boost::system::error_code& ec) {
+    ec.clear();
+#if defined(UDT_IO_URING_RECEIVE)
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = static_cast<uint32_t>(buffers_count_ * 2);
+    ring_fd_ = static_cast<int>(
+        ::syscall(__NR_io_uring_setup, SQ_ENTRIES, &params));
+    if (ring_fd_ < 0 || !MapRing(params) || !RegisterBufferRing()) {
+      AssignErrno(ec);
+      Close();
+      return;
+    }
+
+    int event_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    if (event_fd < 0) {
+      AssignErrno(ec);
+      Close();
+      return;
+    }
+    event_descriptor_.assign(event_fd, ec);
+    if (ec) {
+      ::close(event_fd);
+      Close();
+      return;
+    }
+    if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_EVENTFD,
+                  &event_fd, 1) < 0) {
+      AssignErrno(ec);
+      Close();
+      return;
+    }
+
+    native_socket_ = native_socket;
+    if (!Arm()) {
+      AssignErrno(ec);
+      Close();
+    }
+#else
+    (void)native_socket;
+    ec.assign(boost::system::errc::function_not_supported,
+              boost::system::generic_category());
+#endif  // defined(UDT_IO_URING_RECEIVE)
+  }
+
+  /// Release the ring, its buffers and the eventfd
+  void Close() {
+#if defined(UDT_IO_URING_RECEIVE)
+    boost::system::error_code ec;
+    event_descriptor_.close(ec);
+    if (ring_fd_ >= 0) {
+      // Closing the ring cancels the pending receive
+      ::close(ring_fd_);
+      ring_fd_ = -1;
+    }
+    Unmap(p_sqes_, sqes_size_);
+    if (p_cq_ring_ != p_sq_ring_) {
+      Unmap(p_cq_ring_, cq_ring_size_);
+    }
+    p_cq_ring_ = nullptr;
+    Unmap(p_sq_ring_, sq_ring_size_);
+    if (p_buf_ring_ != nullptr) {
+      ::munmap(p_buf_ring_, buf_ring_size_);
+      p_buf_ring_ = nullptr;
+    }
+#endif  // defined(UDT_IO_URING_RECEIVE)
+  }
+
+  bool is_open() const { return ring_fd_ >= 0; }
+
+  /// Wait for completions
+  /**
+  * @param handler Called as handler(const error_code&, std::size_t) once
+  *   completions are pending, with operation_aborted after Cancel
+  */
+  template <class Handler>
+  void AsyncWait(Handler handler) {
+#if defined(UDT_IO_URING_RECEIVE)
+    event_descriptor_.async_read_some(
+        boost::asio::buffer(&event_count_, sizeof(event_count_)),
+        std::move(handler));
+#else
+    (void)handler;
+#endif  // defined(UDT_IO_URING_RECEIVE)
+  }
+
+  /// Abort the pending wait, the ring is released on Close
+  void Cancel() {
+#if defined(UDT_IO_URING_RECEIVE)
+    boost::system::error_code ec;
+    event_descriptor_.cancel(ec);
+#endif  // defined(UDT_IO_URING_RECEIVE)
+  }
+
+  /// Dispatch completed datagrams and recycle their buffers
+  /**
+  * The handler reads the datagrams in the provided buffers, nothing is
+  * copied. Buffers are given back to the kernel once every completion was
+  * dispatched.
+  *
+  * @param handler Called per datagram as
+  *   handler(const_buffer, segment_size, const Endpoint&,
+  *   const ArrivalTimePoint&), segment_size being 0 if not coalesced and
+  *   the arrival time unset if not timestamped. The buffer is only valid
+  *   during the call
+  * @param ec Set if the receive can not be armed again
+  * @return number of completed receives
+  */
+  template <class Handler>
+  std::size_t Drain(Handler handler, boost::system::error_code& ec) {
+    ec.clear();
+    std::size_t received(0);
+#if defined(UDT_IO_URING_RECEIVE)
+    bool rearm(false);
+    if (msg_.msg_controllen != 0) {
+      timestamp_converter_.Sync();
+    }
+    uint32_t head(*p_cq_head_);
+    uint32_t tail(__atomic_load_n(p_cq_tail_, __ATOMIC_ACQUIRE));
+    for (; head != tail; ++head) {
+      const struct io_uring_cqe& cqe = p_cqes_[head & cq_mask_];
+      if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        rearm = true;
+      }
+      if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+        // -ENOBUFS when the kernel ran out of buffers : re-armed below
+        if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+          ec.assign(-cqe.res, boost::system::system_category());
+        }
+        continue;
+      }
+
+      uint16_t buffer_id(
+          static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+      if (cqe.res > 0) {
+        ++received;
+        Dispatch(buffer_id, static_cast<std::size_t>(cqe.res), handler);
+      }
+      AddBuffer(buffer_id);
+    }
+    __atomic_store_n(p_cq_head_, head, __ATOMIC_RELEASE);
+    __atomic_store_n(&p_buf_ring_->tail, buf_ring_tail_, __ATOMIC_RELEASE);
+
+    if (ec) {
+      return received;
+    }
+    if (rearm && !Arm()) {
+      AssignErrno(ec);
+    }
+#else
+    (void)handler;
+    ec.assign(boost::system::errc::function_not_supported,
+              boost::system::generic_category());
+#endif  // defined(UDT_IO_URING_RECEIVE)
+
+    return received;
+  }
+
+ private:
+  enum : uint32_t { SQ_ENTRIES = 4 };
+  enum : uint16_t { BUFFER_GROUP = 0 };
+
+  static std::size_t RoundUpPowerOfTwo(std::size_t count) {
+    std::size_t power(1);
+    while (power < count && power < 32768) {
+      power <<= 1;
+    }
+    return power;
+  }
+
+  static void AssignErrno(boost::system::error_code& ec) {
+    ec.assign(errno ? errno : EINVAL, boost::system::system_category());
+  }
+
+#if defined(UDT_IO_URING_RECEIVE)
+  static void Unmap(void*& p_memory, std::size_t size) {
+    if (p_memory != nullptr) {
+      ::munmap(p_memory, size);
+      p_memory = nullptr;
+    }
+  }
+
+  static void* Map(std::size_t size, int fd, off_t offset) {
+    void* p_memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, offset);
+    return p_memory == MAP_FAILED ? nullptr : p_memory;
+  }
+
+  bool MapRing(const struct io_uring_params& params) {
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    p_sq_ring_ = Map(sq_ring_size_, ring_fd_, IORING_OFF_SQ_RING);
+    if (p_sq_ring_ == nullptr) {
+      return false;
+    }
+    p_cq_ring_ = (params.features & IORING_FEAT_SINGLE_MMAP)
+                     ? p_sq_ring_
+                     : Map(cq_ring_size_, ring_fd_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    p_sqes_ = Map(sqes_size_, ring_fd_, IORING_OFF_SQES);
+    if (p_cq_ring_ == nullptr || p_sqes_ == nullptr) {
+      return false;
+    }
+
+    uint8_t* p_sq(static_cast<uint8_t*>(p_sq_ring_));
+    p_sq_tail_ = reinterpret_cast<uint32_t*>(p_sq + params.sq_off.tail);
+    p_sq_array_ = reinterpret_cast<uint32_t*>(p_sq + params.sq_off.array);
+    sq_mask_ = *reinterpret_cast<uint32_t*>(p_sq + params.sq_off.ring_mask);
+
+    uint8_t* p_cq(static_cast<uint8_t*>(p_cq_ring_));
+    p_cq_head_ = reinterpret_cast<uint32_t*>(p_cq + params.cq_off.head);
+    p_cq_tail_ = reinterpret_cast<uint32_t*>(p_cq + params.cq_off.tail);
+    p_cqes_ = reinterpret_cast<struct io_uring_cqe*>(p_cq + params.cq_off.cqes);
+    cq_mask_ = *reinterpret_cast<uint32_t*>(p_cq + params.cq_off.ring_mask);
+
+    return true;
+  }
+
+  bool RegisterBufferRing() {
+    buf_ring_size_ = buffers_count_ * sizeof(struct io_uring_buf);
+    void* p_memory = ::mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE,
+                            MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (p_memory == MAP_FAILED) {
+      return false;
+    }
+    p_buf_ring_ = static_cast<struct io_uring_buf_ring*>(p_memory);
+
+    struct io_uring_buf_reg registration;
+    std::memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<uint64_t>(p_buf_ring_);
+    registration.ring_entries = static_cast<uint32_t>(buffers_count_);
+    registration.bgid = BUFFER_GROUP;
+    if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PBUF_RING,
+                  &registration, 1) < 0) {
+      return false;
+    }
+
+    buf_ring_tail_ = 0;
+    for (std::size_t i = 0; i < buffers_count_; ++i) {
+      AddBuffer(static_cast<uint16_t>(i));
+    }
+    __atomic_store_n(&p_buf_ring_->tail, buf_ring_tail_, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  /// Give a buffer back to the kernel, published with the ring tail
+  void AddBuffer(uint16_t buffer_id) {
+    // Entries overlay the ring header : io_uring_buf_ring::bufs is not used
+    // as its empty struct padding is one byte large in C++
+    struct io_uring_buf& buffer = reinterpret_cast<struct io_uring_buf*>(
+        p_buf_ring_)[buf_ring_tail_ & (buffers_count_ - 1)];
+    buffer.addr = reinterpret_cast<uint64_t>(&buffers_[buffer_id * buffer_size_]);
+    buffer.len = static_cast<uint32_t>(buffer_size_);
+    buffer.bid = buffer_id;
+    ++buf_ring_tail_;
+  }
+
+  /// Submit the multishot recvmsg request
+  bool Arm() {
+    uint32_t tail(*p_sq_tail_);
+    uint32_t index(tail & sq_mask_);
+    struct io_uring_sqe& sqe = static_cast<struct io_uring_sqe*>(p_sqes_)[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_RECVMSG;
+    sqe.fd = native_socket_;
+    sqe.addr = reinterpret_cast<uint64_t>(&msg_);
+    sqe.ioprio = IORING_RECV_MULTISHOT;
+    sqe.flags = IOSQE_BUFFER_SELECT;
+    sqe.buf_group = BUFFER_GROUP;
+    p_sq_array_[index] = index;
+    __atomic_store_n(p_sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    long result;
+    do {
+      result = ::syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0);
+    } while (result < 0 && errno == EINTR);
+
+    return result == 1;
+  }
+
+  /// Buffer layout : recvmsg_out | name | control | payload
+  template <class Handler>
+  void Dispatch(uint16_t buffer_id, std::size_t length, Handler& handler) {
+    const uint8_t* p_buffer(&buffers_[buffer_id * buffer_size_]);
+    struct io_uring_recvmsg_out out;
+    std::memcpy(&out, p_buffer, sizeof(out));
+
+    std::size_t name_offset(sizeof(out));
+    std::size_t control_offset(name_offset + msg_.msg_namelen);
+    std::size_t payload_offset(control_offset + msg_.msg_controllen);
+    if (length <= payload_offset) {
+      return;
+    }
+
+    std::size_t name_length(
+        std::min<std::size_t>(out.namelen, msg_.msg_namelen));
+    if (name_length > endpoint_.capacity()) {
+      return;
+    }
+    std::memcpy(endpoint_.data(), p_buffer + name_offset, name_length);
+    endpoint_.resize(name_length);
+
+    std::size_t segment_size(0);
+    ArrivalTimePoint arrival_time;
+    if (msg_.msg_controllen != 0) {
+      struct msghdr control;
+      std::memset(&control, 0, sizeof(control));
+      control.msg_control = const_cast<uint8_t*>(p_buffer + control_offset);
+      control.msg_controllen =
+          std::min<std::size_t>(out.controllen, msg_.msg_controllen);
+      segment_size = GetGroSegmentSize(control);
+      arrival_time = timestamp_converter_.GetArrivalTime(control);
+    }
+
+    handler(boost::asio::const_buffer(p_buffer + payload_offset,
+                                      length - payload_offset),
+            segment_size, static_cast<const Endpoint&>(endpoint_),
+            arrival_time);
+  }
+#endif  // defined(UDT_IO_URING_RECEIVE)
+
+ private:
+  UringReceiver(const UringReceiver&) = delete;
+  UringReceiver& operator=(const UringReceiver&) = delete;
+
+ private:
+  std::size_t buffers_count_;
+  std::size_t buffer_size_;
+  std::vector<uint8_t> buffers_;
+  int native_socket_;
+  int ring_fd_;
+  Endpoint endpoint_;
+#if defined(UDT_IO_URING_RECEIVE)
+  boost::asio::posix::stream_descriptor event_descriptor_;
+  uint64_t event_count_;
+  struct msghdr msg_;
+  ReceiveTimestampConverter timestamp_converter_;
+  void* p_sq_ring_;
+  std::size_t sq_ring_size_;
+  void* p_cq_ring_;
+  std::size_t cq_ring_size_;
+  void* p_sqes_;
+  std::size_t sqes_size_;
+  uint32_t* p_sq_tail_;
+  uint32_t* p_sq_array_;
+  uint32_t sq_mask_;
+  uint32_t* p_cq_head_;
+  uint32_t* p_cq_tail_;
+  struct io_uring_cqe* p_cqes_;
+  uint32_t cq_mask_;
+  struct io_uring_buf_ring* p_buf_ring_;
+  std::size_t buf_ring_size_;
+  uint16_t buf_ring_tail_;
+#endif  // defined(UDT_IO_URING_RECEIVE)
+};
+
+}  // io
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_IO_URING_RECEIVER_H_
@@ -46,7 +46,13 @@ class FileLog {
       log_text_stream << log.received_count << " ";
       log_text_stream << log.local_arrival_speed << " ";
       log_text_stream << log.local_estimated_link_capacity << " ";
-      log_text_stream << log.remote_window_flow_size << std::endl;
+      log_text_stream << log.remote_window_flow_size << " ";
+      log_text_stream << log.multiplexer_received_count << " ";
+      log_text_stream << log.multiplexer_packets_per_wakeup << " ";
+      log_text_stream << log.multiplexer_receive_pool_exhausted_count << " ";
+      log_text_stream << log.send_pool_exhausted_count << " ";
+      log_text_stream << log.flow_pacing_error_mean << " ";
+      log_text_stream << log.flow_pacing_error_max << std::endl;
       std::string log_text(log_text_stream.str());
       file_.write(log_text.c_str(), log_text.size());
       file_.flush();
@@ -19,9 +19,15 @@ struct LogEntry {
   uint32_t ack2_count;
   uint32_t ack2_sent_count;
   uint32_t multiplexer_sent_count;
+  uint32_t multiplexer_received_count;
+  double multiplexer_packets_per_wakeup;
+  uint32_t multiplexer_receive_pool_exhausted_count;
   uint32_t flow_sent_count;
+  double flow_pacing_error_mean;
+  long long flow_pacing_error_max;
   uint32_t received_count;
   uint32_t packets_to_send_count;
+  uint32_t send_pool_exhausted_count;
   // remote data
   uint32_t remote_window_flow_size;
   double remote_arrival_speed;
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 
+#include <algorithm>
 #include <atomic>
 #include <map>
 #include <memory>
@@ -12,18 +13,31 @@
 #include <boost/bind.hpp>
 #include <boost/chrono.hpp>
 #include <boost/log/trivial.hpp>
-#include <boost/optional.hpp>
 
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
 
 #include <boost/system/error_code.hpp>
 
+#include <boost/thread/mutex.hpp>
+
 #include "udt/common/error/error.h"
 
+#include "udt/connected_protocol/common/session_table.h"
 #include "udt/connected_protocol/flow.h"
+#include "udt/connected_protocol/multiplexer_options.h"
+#include "udt/connected_protocol/timer_pool.h"
 #include "udt/connected_protocol/cache/connection_info.h"
 
+#include "udt/connected_protocol/io/free_list_pool.h"
+#include "udt/connected_protocol/io/receive_batch.h"
+#include "udt/connected_protocol/io/receive_timestamp.h"
+#include "udt/connected_protocol/io/reuseport_steering.h"
+#include "udt/connected_protocol/io/send_batch.h"
+#include "udt/connected_protocol/io/tx_time.h"
+#include "udt/connected_protocol/io/udp_offload.h"
+#include "udt/connected_protocol/io/uring_receiver.h"
+
 #include "udt/connected_protocol/logger/log_entry.h"
 
 namespace connected_protocol {
@@ -31,14 +45,18 @@ namespace connected_protocol {
 template <class Protocol>
 class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
  private:
-  enum { MAX_THREADS_IO_SERVICE_TIMER = 1 };
+  /// Coalesced slots are 64KB each
+  enum { MAX_COALESCED_RECEIVE_BATCH_SIZE = 8 };
+  /// One read pending plus the control packet being dispatched
+  enum { RECEIVE_POOL_SIZE = 4 };
+  /// Minimum datagrams queued in the io_uring buffer ring
+  enum { URING_RECEIVE_BUFFERS = 64 };
 
  private:
   typedef Protocol protocol_type;
   typedef typename Protocol::logger Logger;
   typedef typename protocol_type::next_layer_protocol::socket NextSocket;
   typedef typename protocol_type::next_layer_protocol::endpoint NextEndpoint;
-  typedef std::shared_ptr<NextEndpoint> NextEndpointPtr;
   typedef typename protocol_type::socket_session SocketSession;
   typedef std::shared_ptr<SocketSession> SocketSessionPtr;
   typedef typename protocol_type::acceptor_session AcceptorSession;
@@ -52,38 +70,182 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
 
  private:
   typedef typename protocol_type::GenericReceiveDatagram GenericDatagram;
-  typedef std::shared_ptr<GenericDatagram> GenericDatagramPtr;
   typedef typename protocol_type::ConnectionDatagram ConnectionDatagram;
-  typedef typename protocol_type::GenericControlDatagram ControlDatagram;
-  typedef std::shared_ptr<ControlDatagram> ControlDatagramPtr;
+  typedef typename protocol_type::ControlHeader ControlHeader;
+  typedef typename protocol_type::ControlView ControlView;
   typedef typename protocol_type::DataDatagram DataDatagram;
+  typedef typename protocol_type::DataView DataView;
+  typedef typename protocol_type::SendDatagram SendDatagram;
+  typedef typename protocol_type::CoalescedReceiveDatagram CoalescedDatagram;
+  typedef io::ReceiveBatch<DataDatagram, NextEndpoint> ReceiveBatch;
+  typedef io::ReceiveBatch<CoalescedDatagram, NextEndpoint>
+      CoalescedReceiveBatch;
+  typedef io::SendBatch<SendDatagram, NextEndpoint> SendBatch;
+  typedef io::UringReceiver<NextEndpoint> UringReceiver;
+
+  /// Buffer of a single datagram read, or of a datagram handed over to a
+  /// serialized session thread
+  struct ReceiveSlot {
+    DataDatagram datagram;
+    NextEndpoint endpoint;
+  };
+  typedef io::FreeListPool<ReceiveSlot> ReceivePool;
 
  private:
   typedef std::map<NextEndpoint, FlowPtr> FlowsMap;
-  typedef std::map<SocketId, SocketSessionPtr> FlowSessionsMap;
-  typedef std::map<NextEndpoint, FlowSessionsMap> RemoteEndpointFlowMap;
+  typedef common::SessionTable<SocketSession, NextEndpoint> SessionTable;
+  /// Sessions count per remote endpoint (flow lifetime)
+  typedef std::map<NextEndpoint, uint32_t> RemoteEndpointSessionsMap;
 
  public:
   typedef std::shared_ptr<Multiplexer> Ptr;
 
  public:
-  static Ptr Create(MultiplexerManager *p_manager, NextSocket socket) {
-    return Ptr(new Multiplexer(p_manager, std::move(socket)));
+  /**
+  * @param io_service Application io_service, running the completion
+  *   handlers of the sockets
+  * @param socket UDP socket, opened on io_service or on timer_io_service
+  *   (thread per core)
+  * @param p_timer_pool Threads running pacing and protocol timers, shared
+  *   with the other multiplexers
+  * @param timer_io_service Pool thread running the send batch flushes, and
+  *   every flow and session of the multiplexer with thread_per_core
+  */
+  static Ptr Create(MultiplexerManager *p_manager,
+                    boost::asio::io_service &io_service, NextSocket socket,
+                    TimerPool::Ptr p_timer_pool,
+                    boost::asio::io_service &timer_io_service,
+                    const MultiplexerOptions &options = MultiplexerOptions(),
+                    uint32_t shard = 0, uint32_t shards_count = 1) {
+    return Ptr(new Multiplexer(p_manager, io_service, std::move(socket),
+                               std::move(p_timer_pool), timer_io_service,
+                               options, shard, shards_count));
   }
 
   void Start() {
-    auto &timer_io_service = timer_io_service_;
-    for (uint16_t i = 1; i <= MAX_THREADS_IO_SERVICE_TIMER; ++i) {
-      timer_threads_.create_thread(
-          [&timer_io_service]() { timer_io_service.run(); });
+    // Only io_uring and batched reads provide the control buffer carrying
+    // the kernel timestamp
+    bool message_reads(
+        (UringReceiver::SUPPORTED && options_.io_uring_enabled) ||
+        (ReceiveBatch::SUPPORTED &&
+         (options_.receive_batch_size > 1 || options_.gro_enabled)));
+    if (options_.receive_timestamps_enabled && !message_reads) {
+      BOOST_LOG_TRIVIAL(trace)
+          << "Multiplexer : kernel receive timestamps disabled, "
+          << "they need batched or io_uring receive";
+    } else if (options_.receive_timestamps_enabled) {
+      boost::system::error_code ec;
+      io::EnableReceiveTimestamps(socket_.native_handle(), ec);
+      receive_timestamps_ = !ec;
+      if (ec) {
+        BOOST_LOG_TRIVIAL(trace)
+            << "Multiplexer : kernel receive timestamps disabled, "
+            << ec.message();
+      }
+    }
+
+    if (UringReceiver::SUPPORTED && options_.io_uring_enabled) {
+      StartUringReceiver();
+    }
+
+    if (!p_uring_receiver_ && ReceiveBatch::SUPPORTED &&
+        (options_.receive_batch_size > 1 || options_.gro_enabled)) {
+      boost::system::error_code ec;
+      socket_.non_blocking(true, ec);
+      if (!ec && options_.gro_enabled) {
+        io::EnableGro(socket_.native_handle(), ec);
+        if (!ec) {
+          p_coalesced_receive_batch_.reset(new CoalescedReceiveBatch(
+              std::max<uint32_t>(
+                  1, std::min<uint32_t>(options_.receive_batch_size,
+                                        MAX_COALESCED_RECEIVE_BATCH_SIZE)),
+              true, receive_timestamps_));
+        } else {
+          BOOST_LOG_TRIVIAL(trace)
+              << "Multiplexer : UDP receive offload disabled, "
+              << ec.message();
+          ec.clear();
+        }
+      }
+      if (!ec && !p_coalesced_receive_batch_ &&
+          options_.receive_batch_size > 1) {
+        p_receive_batch_.reset(new ReceiveBatch(options_.receive_batch_size,
+                                                false, receive_timestamps_));
+      } else if (ec) {
+        BOOST_LOG_TRIVIAL(trace)
+            << "Multiplexer : batched receive disabled, " << ec.message();
+      }
+    }
+
+    if (receive_timestamps_ && !p_uring_receiver_ && !p_receive_batch_ &&
+        !p_coalesced_receive_batch_) {
+      // Stamped but read without control buffer
+      BOOST_LOG_TRIVIAL(trace)
+          << "Multiplexer : kernel receive timestamps ignored, "
+          << "batched and io_uring receive unavailable";
+      receive_timestamps_ = false;
     }
+
+    if (SendBatch::SUPPORTED && options_.send_batch_size > 1) {
+      p_send_batch_.reset(new SendBatch(options_.send_batch_size));
+      if (options_.gso_enabled) {
+        if (io::IsGsoSupported(socket_.native_handle())) {
+          p_send_batch_->set_gso(true);
+        } else {
+          BOOST_LOG_TRIVIAL(trace)
+              << "Multiplexer : UDP segmentation offload not supported";
+        }
+      }
+      if (options_.tx_time_enabled) {
+        boost::system::error_code ec;
+        io::EnableTxTime(socket_.native_handle(), ec);
+        if (!ec) {
+          p_send_batch_->set_tx_time(true);
+          tx_time_converter_.Sync();
+          tx_time_ = true;
+        } else {
+          BOOST_LOG_TRIVIAL(trace)
+              << "Multiplexer : kernel pacing disabled, " << ec.message();
+        }
+      }
+    }
+
+    if (shard_ == 0 && shards_count_ > 1) {
+      // The program is shared by the whole reuseport group
+      boost::system::error_code ec;
+      io::AttachSocketIdSteering(socket_.native_handle(), shards_count_, ec);
+      if (ec) {
+        BOOST_LOG_TRIVIAL(trace)
+            << "Multiplexer : socket id steering disabled, " << ec.message();
+      }
+    }
+
+    if (options_.thread_per_core) {
+      // The receive loop runs on the multiplexer thread : keep the
+      // application io_service running as when it received
+      p_application_work_.reset(new boost::asio::io_service::work(io_service_));
+    }
+
     running_ = true;
     ReadPacket();
   }
 
+  /// Timer io_service of the multiplexer (send batch flushes)
   boost::asio::io_service &get_timer_io_service() { return timer_io_service_; }
 
-  boost::asio::io_service &get_io_service() { return socket_.get_io_service(); }
+  /// Timer io_service for a new flow or session, in turn among the pool
+  /// threads or the multiplexer own thread with thread_per_core
+  boost::asio::io_service &NextTimerIoService() {
+    return options_.thread_per_core ? timer_io_service_
+                                    : p_timer_pool_->NextIoService();
+  }
+
+  /// Application io_service, running the completion handlers of the sockets
+  boost::asio::io_service &get_io_service() { return io_service_; }
+
+  uint32_t shard() const { return shard_; }
+
+  const MultiplexerOptions &options() const { return options_; }
 
   NextEndpoint local_endpoint(boost::system::error_code &ec) {
     return socket_.local_endpoint(ec);
@@ -95,9 +257,9 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
     boost::recursive_mutex::scoped_lock lock_sockets_map(sessions_mutex_);
     SocketId id(0);
     if (user_socket_id == 0) {
-      id = GenerateSocketId(next_remote_endpoint);
+      id = GenerateSocketId();
     } else {
-      id = IsSocketIdAvailable(next_remote_endpoint, user_socket_id)
+      id = IsSocketIdAvailable(user_socket_id)
                ? user_socket_id
                : 0;
     }
@@ -114,7 +276,8 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
     p_session->socket_id = id;
     p_session->set_next_local_endpoint(local_endpoint(ec));
     p_session->set_next_remote_endpoint(next_remote_endpoint);
-    remote_endpoint_flow_sessions_[next_remote_endpoint][id] = p_session;
+    sessions_.Insert(id, next_remote_endpoint, p_session);
+    ++remote_endpoint_sessions_[next_remote_endpoint];
     return p_session;
   }
 
@@ -123,19 +286,20 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
     boost::recursive_mutex::scoped_lock lock_sockets_map(sessions_mutex_);
     boost::recursive_mutex::scoped_lock lock_flows(flows_mutex_);
 
-    typename RemoteEndpointFlowMap::iterator r_ep_flow_it(
-        remote_endpoint_flow_sessions_.find(next_remote_endpoint));
-    if (r_ep_flow_it == remote_endpoint_flow_sessions_.end()) {
+    typename RemoteEndpointSessionsMap::iterator r_ep_sessions_it(
+        remote_endpoint_sessions_.find(next_remote_endpoint));
+    if (r_ep_sessions_it == remote_endpoint_sessions_.end() ||
+        !sessions_.Find(socket_id, next_remote_endpoint)) {
       return;
     }
 
-    r_ep_flow_it->second.erase(socket_id);
-    if (r_ep_flow_it->second.empty()) {
+    sessions_.Remove(socket_id);
+    if (--r_ep_sessions_it->second == 0) {
       RemoveFlow(next_remote_endpoint);
-      remote_endpoint_flow_sessions_.erase(next_remote_endpoint);
+      remote_endpoint_sessions_.erase(r_ep_sessions_it);
     }
-    if (remote_endpoint_flow_sessions_.empty() && !p_acceptor_) {
-      p_manager_->CleanMultiplexer(socket_.local_endpoint());
+    if (remote_endpoint_sessions_.empty() && !p_acceptor_) {
+      p_manager_->CleanMultiplexer(socket_.local_endpoint(), shard_);
     }
   }
 
@@ -148,7 +312,7 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
     }
     p_acceptor_ = p_acceptor;
 
-    p_acceptor->set_p_multiplexer(this->shared_from_this());
+    p_acceptor->AddMultiplexer(this->shared_from_this());
 
     ec.assign(::common::error::success, ::common::error::get_error_category());
   }
@@ -158,8 +322,8 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
     boost::recursive_mutex::scoped_lock lock_acceptor(acceptor_mutex_);
     p_acceptor_.reset();
 
-    if (remote_endpoint_flow_sessions_.empty() && !p_acceptor_) {
-      p_manager_->CleanMultiplexer(socket_.local_endpoint());
+    if (remote_endpoint_sessions_.empty() && !p_acceptor_) {
+      p_manager_->CleanMultiplexer(socket_.local_endpoint(), shard_);
     }
   }
 
@@ -172,10 +336,12 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
                           std::move(handler));
   }
 
+  /// Send a data packet handed out by its sender, notified once sent
   template <class Datagram, class Handler>
   void AsyncSendDataPacket(Datagram *p_datagram,
                            const NextEndpoint &next_endpoint, Handler handler) {
     if (p_datagram->is_acked()) {
+      p_datagram->OnSent();
       this->get_io_service().post(
           boost::asio::detail::binder2<decltype(handler),
                                        boost::system::error_code, std::size_t>(
@@ -185,11 +351,10 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
               0));
       return;
     }
-    p_datagram->set_pending_send(true);
     auto self = this->shared_from_this();
     auto sent_handler = [p_datagram, handler, self](
         const boost::system::error_code &sent_ec, std::size_t length) {
-      p_datagram->set_pending_send(false);
+      p_datagram->OnSent();
       if (!sent_ec && Logger::ACTIVE) {
         self->sent_count_ = self->sent_count_.load() + 1;
       }
@@ -199,102 +364,476 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
                           std::move(sent_handler));
   }
 
+  /// Queue data packet in the send batch
+  /**
+  * The batch is flushed with one sendmmsg call once full or when the timer
+  * io_service runs the flush posted by the first queued packet, so packets
+  * queued by every flow of the multiplexer in the meantime share the call.
+  *
+  * @param departure_time Passed to the kernel (SO_TXTIME) when kernel pacing
+  *   is on, ignored otherwise
+  */
+  void QueueDataPacket(
+      SendDatagram *p_datagram, const NextEndpoint &next_endpoint,
+      const io::DepartureTimePoint &departure_time = io::DepartureTimePoint()) {
+    if (!p_send_batch_) {
+      AsyncSendDataPacket(p_datagram, next_endpoint,
+                          [](const boost::system::error_code &, std::size_t) {
+                          });
+      return;
+    }
+
+    if (p_datagram->is_acked()) {
+      p_datagram->OnSent();
+      return;
+    }
+
+    bool flush_now(false);
+    bool post_flush(false);
+    bool tx_time_rejected(false);
+    {
+      boost::mutex::scoped_lock lock_send_batch(send_batch_mutex_);
+      if (!AddDataPacket(p_datagram, next_endpoint, departure_time)) {
+        // Filled by another flow not flushed yet : flush it here
+        tx_time_rejected = SendDataPackets();
+        AddDataPacket(p_datagram, next_endpoint, departure_time);
+      }
+      flush_now = p_send_batch_->full();
+      if (!flush_now && !flush_pending_) {
+        flush_pending_ = true;
+        post_flush = true;
+      }
+    }
+
+    if (tx_time_rejected) {
+      DisableTxTime();
+    }
+
+    if (flush_now) {
+      FlushDataPackets();
+    } else if (post_flush) {
+      timer_io_service_.post(boost::bind(&Multiplexer::FlushDataPackets,
+                                         this->shared_from_this()));
+    }
+  }
+
+  void FlushDataPackets() {
+    bool tx_time_rejected(false);
+    {
+      boost::mutex::scoped_lock lock_send_batch(send_batch_mutex_);
+      flush_pending_ = false;
+      if (!p_send_batch_->empty()) {
+        tx_time_rejected = SendDataPackets();
+      }
+      if (p_send_batch_->tx_time()) {
+        tx_time_converter_.Sync();
+      }
+    }
+
+    if (tx_time_rejected) {
+      DisableTxTime();
+    }
+  }
+
   void Log(connected_protocol::logger::LogEntry *p_log) {
     p_log->multiplexer_sent_count = sent_count_.load();
+    p_log->multiplexer_received_count = received_count_.load();
+    uint32_t wakeup_count = receive_wakeup_count_.load();
+    p_log->multiplexer_packets_per_wakeup =
+        wakeup_count ? (double)received_count_.load() / wakeup_count : 0.0;
+    p_log->multiplexer_receive_pool_exhausted_count =
+        receive_pool_.exhausted_count();
   }
 
-  void ResetLog() { sent_count_ = 0; }
+  void ResetLog() {
+    sent_count_ = 0;
+    received_count_ = 0;
+    receive_wakeup_count_ = 0;
+    receive_pool_.reset_exhausted_count();
+  }
 
   void Stop(boost::system::error_code &ec) {
     running_ = false;
-    p_worker_.reset();
-    timer_threads_.join_all();
+    if (p_uring_receiver_) {
+      p_uring_receiver_->Cancel();
+    }
     socket_.shutdown(boost::asio::socket_base::shutdown_both, ec);
     socket_.close(ec);
+    p_application_work_.reset();
   }
 
  private:
-  Multiplexer(MultiplexerManager *p_manager, NextSocket socket)
+  Multiplexer(MultiplexerManager *p_manager,
+              boost::asio::io_service &io_service, NextSocket socket,
+              TimerPool::Ptr p_timer_pool,
+              boost::asio::io_service &timer_io_service,
+              const MultiplexerOptions &options, uint32_t shard,
+              uint32_t shards_count)
       : p_manager_(p_manager),
+        options_(options),
+        shard_(shard),
+        shards_count_(shards_count),
+        io_service_(io_service),
+        p_application_work_(nullptr),
         socket_(std::move(socket)),
-        timer_io_service_(),
-        p_worker_(new boost::asio::io_service::work(timer_io_service_)),
+        p_timer_pool_(std::move(p_timer_pool)),
+        timer_io_service_(timer_io_service),
         running_(false),
         flows_mutex_(),
         flows_(),
         sessions_mutex_(),
-        remote_endpoint_flow_sessions_(),
+        sessions_(),
+        remote_endpoint_sessions_(),
         acceptor_mutex_(),
         p_acceptor_(nullptr),
         gen_(static_cast<uint32_t>(
             boost::chrono::duration_cast<boost::chrono::nanoseconds>(
                 boost::chrono::high_resolution_clock::now().time_since_epoch())
-                .count())) {}
+                .count())),
+        receive_pool_(RECEIVE_POOL_SIZE),
+        p_receive_batch_(nullptr),
+        p_coalesced_receive_batch_(nullptr),
+        p_uring_receiver_(nullptr),
+        receive_timestamps_(false),
+        send_batch_mutex_(),
+        p_send_batch_(nullptr),
+        flush_pending_(false),
+        tx_time_converter_(),
+        tx_time_(false),
+        sent_count_(0),
+        received_count_(0),
+        receive_wakeup_count_(0) {}
+
+  /// Send batch lock held
+  /// @return false if the batch is full
+  bool AddDataPacket(SendDatagram *p_datagram,
+                     const NextEndpoint &next_endpoint,
+                     const io::DepartureTimePoint &departure_time) {
+    return p_send_batch_->Add(
+        p_datagram, next_endpoint,
+        p_send_batch_->tx_time() ? tx_time_converter_.GetTxTime(departure_time)
+                                 : 0);
+  }
+
+  /// Flows go back to timer pacing
+  void DisableTxTime() {
+    tx_time_ = false;
+    boost::recursive_mutex::scoped_lock lock_flows(flows_mutex_);
+    for (auto &flow_pair : flows_) {
+      flow_pair.second->set_departure_horizon(boost::chrono::microseconds(0));
+    }
+  }
+
+  /// Send the batch, send batch lock held
+  /// @return true if the kernel rejected departure times
+  bool SendDataPackets() {
+    boost::system::error_code ec;
+    bool gso(p_send_batch_->gso());
+    bool tx_time(p_send_batch_->tx_time());
+    std::size_t sent(p_send_batch_->Send(socket_.native_handle(), ec));
+    if (ec) {
+      BOOST_LOG_TRIVIAL(trace) << "Multiplexer : batched send error, "
+                               << ec.message();
+    }
+    if (gso && !p_send_batch_->gso()) {
+      BOOST_LOG_TRIVIAL(trace)
+          << "Multiplexer : UDP segmentation offload rejected, disabled";
+    }
+    bool tx_time_rejected(tx_time && !p_send_batch_->tx_time());
+    if (tx_time_rejected) {
+      BOOST_LOG_TRIVIAL(trace)
+          << "Multiplexer : kernel pacing rejected, disabled";
+    }
+
+    for (std::size_t i = 0; i < sent; ++i) {
+      p_send_batch_->datagram(i)->OnSent();
+    }
+
+    if (Logger::ACTIVE) {
+      sent_count_ = sent_count_.load() + sent;
+    }
+
+    // Socket buffer full or error : remaining packets go the async way
+    for (std::size_t i = sent; i < p_send_batch_->size(); ++i) {
+      SendDatagram *p_datagram = p_send_batch_->datagram(i);
+      AsyncSendDataPacket(p_datagram, p_send_batch_->endpoint(i),
+                          [](const boost::system::error_code &, std::size_t) {
+                          });
+    }
+
+    p_send_batch_->Clear();
+
+    return tx_time_rejected;
+  }
+
+  /// Receive through io_uring, left disabled if the kernel refuses it
+  void StartUringReceiver() {
+    boost::system::error_code ec;
+    bool coalesced(false);
+    if (options_.gro_enabled) {
+      io::EnableGro(socket_.native_handle(), ec);
+      coalesced = !ec;
+      ec.clear();
+    }
+
+    p_uring_receiver_.reset(new UringReceiver(
+        socket_.get_io_service(),
+        std::max<uint32_t>(URING_RECEIVE_BUFFERS, options_.receive_batch_size),
+        coalesced ? static_cast<std::size_t>(
+                        protocol_type::MAX_COALESCED_DATAGRAM_SIZE)
+                  : static_cast<std::size_t>(GenericDatagram::size),
+        coalesced, receive_timestamps_));
+    p_uring_receiver_->Open(socket_.native_handle(), ec);
+    if (ec) {
+      BOOST_LOG_TRIVIAL(trace) << "Multiplexer : io_uring receive disabled, "
+                               << ec.message();
+      p_uring_receiver_.reset();
+    }
+  }
 
   void ReadPacket() {
     if (!running_.load() || !socket_.is_open()) {
       return;
     }
-    auto p_generic_packet = std::make_shared<GenericDatagram>();
-    auto p_next_remote_endpoint = std::make_shared<NextEndpoint>();
+
+    if (p_uring_receiver_) {
+      // The receive stays armed in the ring, wait for its completions
+      p_uring_receiver_->AsyncWait(
+          boost::bind(&Multiplexer::HandleUringCompletions,
+                      this->shared_from_this(), _1));
+      return;
+    }
+
+    if (p_receive_batch_ || p_coalesced_receive_batch_) {
+      // Wait for readiness only, datagrams are drained by recvmmsg
+      socket_.async_receive(
+          boost::asio::null_buffers(),
+          boost::bind(&Multiplexer::HandleReadable, this->shared_from_this(),
+                      _1));
+      return;
+    }
+
+    ReceiveSlot *p_slot = receive_pool_.Acquire();
+    io::datagram_mutable_buffers buffers;
+    p_slot->datagram.payload().SetSize(DataDatagram::Payload::size);
+    p_slot->datagram.GetMutableBuffers(&buffers);
     socket_.async_receive_from(
-        p_generic_packet->GetMutableBuffers(), *p_next_remote_endpoint,
+        buffers, p_slot->endpoint,
         boost::bind(&Multiplexer::HandlePacket, this->shared_from_this(),
-                    p_generic_packet, p_next_remote_endpoint, _1, _2));
+                    p_slot, _1, _2));
   }
 
-  void HandlePacket(GenericDatagramPtr p_generic_packet,
-                    NextEndpointPtr p_next_remote_endpoint,
-                    const boost::system::error_code &ec, std::size_t length) {
+  void HandleReadable(const boost::system::error_code &ec) {
     if (!running_.load()) {
       return;
     }
 
-    p_generic_packet->payload().SetSize(length - GenericDatagram::Header::size);
+    if (ec) {
+      ReadPacket();
+      return;
+    }
+
+    if (p_coalesced_receive_batch_) {
+      DrainReceiveBatch(p_coalesced_receive_batch_.get());
+    } else {
+      DrainReceiveBatch(p_receive_batch_.get());
+    }
+
+    ReadPacket();
+  }
+
+  /// Read pending datagrams and dispatch them, splitting coalesced slots
+  template <class Batch>
+  void DrainReceiveBatch(Batch *p_batch) {
+    boost::system::error_code receive_ec;
+    std::size_t received(p_batch->Receive(socket_.native_handle(), receive_ec));
+    if (receive_ec) {
+      BOOST_LOG_TRIVIAL(trace) << "Multiplexer : batched receive error, "
+                               << receive_ec.message();
+    }
+
+    std::size_t datagrams_count(0);
+    for (std::size_t i = 0; i < received; ++i) {
+      io::datagram_const_buffers buffers;
+      p_batch->datagram(i).GetConstBuffers(&buffers);
+      datagrams_count += DispatchSegments(
+          buffers, p_batch->length(i), p_batch->segment_size(i),
+          p_batch->endpoint(i), p_batch->arrival_time(i));
+    }
+
+    if (Logger::ACTIVE) {
+      receive_wakeup_count_ = receive_wakeup_count_.load() + 1;
+      received_count_ = received_count_.load() + datagrams_count;
+    }
+  }
+
+  /// Dispatch the datagrams received by the ring since the last wakeup
+  /**
+  * Sessions are given views on the ring buffers, recycled when the drain
+  * returns.
+  */
+  void HandleUringCompletions(const boost::system::error_code &ec) {
+    if (!running_.load()) {
+      return;
+    }
 
     if (ec) {
       ReadPacket();
       return;
     }
 
-    auto &header = p_generic_packet->header();
-    auto p_socket_session_optional(
-        GetSocketSession(*p_next_remote_endpoint, header.GetSocketId()));
+    std::size_t datagrams_count(0);
+    boost::system::error_code receive_ec;
+    p_uring_receiver_->Drain(
+        [this, &datagrams_count](const boost::asio::const_buffer &buffer,
+                                 std::size_t segment_size,
+                                 const NextEndpoint &next_remote_endpoint,
+                                 const io::ArrivalTimePoint &arrival_time) {
+          datagrams_count += DispatchSegments(
+              boost::asio::const_buffers_1(buffer),
+              boost::asio::buffer_size(buffer), segment_size,
+              next_remote_endpoint, arrival_time);
+        },
+        receive_ec);
+
+    if (Logger::ACTIVE) {
+      receive_wakeup_count_ = receive_wakeup_count_.load() + 1;
+      received_count_ = received_count_.load() + datagrams_count;
+    }
+
+    if (receive_ec) {
+      // Receive could not be armed again : back to socket reads
+      BOOST_LOG_TRIVIAL(trace) << "Multiplexer : io_uring receive disabled, "
+                               << receive_ec.message();
+      p_uring_receiver_.reset();
+    }
+
+    ReadPacket();
+  }
+
+  /// Dispatch a received slot, split when it holds coalesced datagrams
+  /**
+  * Each coalesced datagram is a view on its segment of the slot.
+  *
+  * @param segment_size Size of the coalesced datagrams, 0 if not coalesced
+  * @param arrival_time Kernel receive time, shared by coalesced datagrams
+  * @return number of datagrams dispatched
+  */
+  template <class ConstBufferSequence>
+  std::size_t DispatchSegments(const ConstBufferSequence &buffers,
+                               std::size_t length, std::size_t segment_size,
+                               const NextEndpoint &next_remote_endpoint,
+                               const io::ArrivalTimePoint &arrival_time) {
+    if (segment_size == 0 || segment_size >= length) {
+      DispatchPacket(buffers, length, next_remote_endpoint, arrival_time);
+      return 1;
+    }
+
+    std::size_t datagrams_count(0);
+    for (std::size_t offset = 0; offset < length; offset += segment_size) {
+      std::size_t datagram_length(std::min(segment_size, length - offset));
+      ++datagrams_count;
+      DispatchPacket(io::SliceBuffers<io::datagram_const_buffers>(
+                         buffers, offset, datagram_length),
+                     datagram_length, next_remote_endpoint, arrival_time);
+    }
+
+    return datagrams_count;
+  }
+
+  void HandlePacket(ReceiveSlot *p_slot, const boost::system::error_code &ec,
+                    std::size_t length) {
+    if (!running_.load()) {
+      receive_pool_.Release(p_slot);
+      return;
+    }
+
+    if (ec) {
+      receive_pool_.Release(p_slot);
+      ReadPacket();
+      return;
+    }
+
+    if (Logger::ACTIVE) {
+      receive_wakeup_count_ = receive_wakeup_count_.load() + 1;
+      received_count_ = received_count_.load() + 1;
+    }
+
+    io::datagram_const_buffers buffers;
+    p_slot->datagram.GetConstBuffers(&buffers);
+
+    typename GenericDatagram::Header header;
+    boost::asio::buffer_copy(boost::asio::buffer(header.data()), buffers);
+    if (header.IsControlPacket()) {
+      // Control packets do not keep the receive loop waiting
+      ReadPacket();
+      DispatchPacket(buffers, length, p_slot->endpoint, io::ArrivalTimePoint(),
+                     &p_slot);
+      if (p_slot) {
+        receive_pool_.Release(p_slot);
+      }
+      return;
+    }
+
+    DispatchPacket(buffers, length, p_slot->endpoint, io::ArrivalTimePoint(),
+                   &p_slot);
+    if (p_slot) {
+      receive_pool_.Release(p_slot);
+    }
+    ReadPacket();
+  }
+
+  /// Forward a received datagram to its session or to the acceptor
+  /**
+  * Data and control packets are handed to the session as views on the
+  * receive buffer, only handshakes are copied.
+  *
+  * @param buffers Fixed size view on the received bytes
+  * @param length Datagram size, header included
+  * @param arrival_time Kernel receive time, unset if unknown
+  * @param pp_slot Receive slot holding the bytes, if any : taken over (set
+  *   to null) when the packet is handed to a serialized session thread
+  */
+  template <class ConstBufferSequence>
+  void DispatchPacket(
+      const ConstBufferSequence &buffers, std::size_t length,
+      const NextEndpoint &next_remote_endpoint,
+      const io::ArrivalTimePoint &arrival_time = io::ArrivalTimePoint(),
+      ReceiveSlot **pp_slot = nullptr) {
+    if (length < GenericDatagram::Header::size ||
+        length > GenericDatagram::size) {
+      // Drop truncated or oversized datagram
+      return;
+    }
+
+    typename GenericDatagram::Header header;
+    boost::asio::buffer_copy(boost::asio::buffer(header.data()), buffers);
+    SocketSessionPtr p_socket_session(
+        sessions_.Find(header.GetSocketId(), next_remote_endpoint));
 
     if (header.IsDataPacket()) {
-      if (!p_socket_session_optional) {
+      if (!p_socket_session) {
         // Drop datagram if no session found
-        ReadPacket();
         return;
       }
 
-      DataDatagram data_datagram;
-      boost::asio::buffer_copy(data_datagram.header().GetMutableBuffers(),
-                               p_generic_packet->header().GetConstBuffers());
-      auto &data_payload = data_datagram.payload();
-      auto &received_payload = p_generic_packet->payload();
-      data_payload = std::move(received_payload);
-      // Forward DataDatagram
-      (*p_socket_session_optional)->PushDataDgr(&data_datagram);
-      ReadPacket();
+      ForwardPacket(p_socket_session, buffers, length, arrival_time, pp_slot);
       return;
     }
 
     if (header.IsControlPacket()) {
-      ReadPacket();
-      ControlDatagram control_datagram;
-      boost::asio::buffer_copy(control_datagram.GetMutableBuffers(),
-                               p_generic_packet->GetConstBuffers());
-      control_datagram.payload().SetSize(p_generic_packet->payload().GetSize());
-      if (control_datagram.header().IsType(
-              ControlDatagram::Header::CONNECTION)) {
+      ControlView control_view(buffers, length);
+      if (!control_view.IsValid()) {
+        return;
+      }
+      if (control_view.header().IsType(ControlHeader::CONNECTION)) {
+        // Handshake datagrams are kept and answered : copy them
         auto p_connection_datagram = std::make_shared<ConnectionDatagram>();
         boost::asio::buffer_copy(p_connection_datagram->GetMutableBuffers(),
-                                 control_datagram.GetConstBuffers());
+                                 buffers);
 
-        if (p_socket_session_optional) {
-          (*p_socket_session_optional)
-              ->PushConnectionDgr(p_connection_datagram);
+        if (p_socket_session) {
+          p_socket_session->PushConnectionDgr(p_connection_datagram);
           return;
         }
 
@@ -302,46 +841,109 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
           boost::recursive_mutex::scoped_lock(acceptor_mutex_);
           // Check if acceptor exists
           if (p_acceptor_) {
-            p_acceptor_->PushConnectionDgr(p_connection_datagram,
-                                           p_next_remote_endpoint);
+            p_acceptor_->PushConnectionDgr(
+                p_connection_datagram,
+                std::make_shared<NextEndpoint>(next_remote_endpoint),
+                this->shared_from_this());
             return;
           }
         }
 
         // Drop connection datagram
       } else {
-        if (!p_socket_session_optional) {
+        if (!p_socket_session) {
           // Drop datagram
           return;
         }
-        // Forward ControlDatagram
-        (*p_socket_session_optional)->PushControlDgr(&control_datagram);
+        ForwardPacket(p_socket_session, buffers, length, arrival_time,
+                      pp_slot);
       }
     }
   }
 
-  bool IsSocketIdAvailable(const NextEndpoint &next_remote_endpoint,
-                           SocketId socket_id) {
-    boost::recursive_mutex::scoped_lock lock_sockets_map(sessions_mutex_);
-    typename RemoteEndpointFlowMap::const_iterator r_ep_flow_it(
-        remote_endpoint_flow_sessions_.find(next_remote_endpoint));
-    if (r_ep_flow_it == remote_endpoint_flow_sessions_.end()) {
-      return true;
+  /// Forward a data or control packet to its session
+  /**
+  * Views on the receive buffer are pushed in place, unless the session is
+  * serialized on another thread : the packet is then handed over in a
+  * receive slot (the one holding it or a pooled copy), released once the
+  * session thread processed it.
+  */
+  template <class ConstBufferSequence>
+  void ForwardPacket(const SocketSessionPtr &p_socket_session,
+                     const ConstBufferSequence &buffers, std::size_t length,
+                     const io::ArrivalTimePoint &arrival_time,
+                     ReceiveSlot **pp_slot) {
+    if (IsSessionThread(*p_socket_session)) {
+      PushPacket(*p_socket_session, buffers, length, arrival_time);
+      return;
     }
 
-    typename FlowSessionsMap::const_iterator session_it(
-        r_ep_flow_it->second.find(socket_id));
-    return session_it == r_ep_flow_it->second.end();
+    ReceiveSlot *p_slot(nullptr);
+    if (pp_slot) {
+      p_slot = *pp_slot;
+      *pp_slot = nullptr;
+    } else {
+      // Batch, coalesced and ring buffers are reused by the next read
+      p_slot = receive_pool_.Acquire();
+      p_slot->datagram.payload().SetSize(DataDatagram::Payload::size);
+      io::datagram_mutable_buffers slot_buffers;
+      p_slot->datagram.GetMutableBuffers(&slot_buffers);
+      boost::asio::buffer_copy(
+          slot_buffers,
+          io::SliceBuffers<io::datagram_const_buffers>(buffers, 0, length));
+    }
+
+    auto self = this->shared_from_this();
+    p_socket_session->get_protocol_io_service().post(
+        [self, p_socket_session, p_slot, length, arrival_time]() {
+          io::datagram_const_buffers slot_buffers;
+          p_slot->datagram.GetConstBuffers(&slot_buffers);
+          self->PushPacket(*p_socket_session, slot_buffers, length,
+                           arrival_time);
+          self->receive_pool_.Release(p_slot);
+        });
+  }
+
+  template <class ConstBufferSequence>
+  void PushPacket(SocketSession &socket_session,
+                  const ConstBufferSequence &buffers, std::size_t length,
+                  const io::ArrivalTimePoint &arrival_time) {
+    typename GenericDatagram::Header header;
+    boost::asio::buffer_copy(boost::asio::buffer(header.data()), buffers);
+    if (header.IsDataPacket()) {
+      socket_session.PushDataDgr(DataView(buffers, length, arrival_time));
+      return;
+    }
+
+    ControlView control_view(buffers, length);
+    if (control_view.IsValid()) {
+      socket_session.PushControlDgr(control_view);
+    }
   }
 
-  SocketId GenerateSocketId(const NextEndpoint &next_remote_endpoint) {
+  /// Serialized sessions run on their flow thread, which is the receiving
+  /// one with thread_per_core only
+  bool IsSessionThread(SocketSession &socket_session) {
+    return !socket_session.serialized() ||
+           &socket_session.get_protocol_io_service() ==
+               &socket_.get_io_service();
+  }
+
+  /// Socket ids are unique on the multiplexer, whatever the remote endpoint
+  bool IsSocketIdAvailable(SocketId socket_id) {
+    return !sessions_.Contains(socket_id);
+  }
+
+  SocketId GenerateSocketId() {
     boost::recursive_mutex::scoped_lock lock_sockets_map(sessions_mutex_);
+    // Sharded ids satisfy id % shards_count_ == shard_ (reuseport steering)
     boost::random::uniform_int_distribution<uint32_t> dist(
-        1, std::numeric_limits<uint32_t>::max());
+        1, std::numeric_limits<uint32_t>::max() / shards_count_ - 1);
     uint32_t rand_id;
     for (int i = 0; i < 100; ++i) {
-      rand_id = dist(gen_);
-      if (IsSocketIdAvailable(next_remote_endpoint, rand_id)) {
+      rand_id = shards_count_ > 1 ? dist(gen_) * shards_count_ + shard_
+                                  : dist(gen_);
+      if (IsSocketIdAvailable(rand_id)) {
         return rand_id;
       }
     }
@@ -349,24 +951,6 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
     return 0;
   }
 
-  boost::optional<SocketSessionPtr> GetSocketSession(
-      const NextEndpoint &next_remote_endpoint, SocketId socket_id) {
-    boost::recursive_mutex::scoped_lock lock_sessions(sessions_mutex_);
-    boost::optional<SocketSessionPtr> session_optional;
-
-    typename RemoteEndpointFlowMap::const_iterator r_ep_flow_it(
-        remote_endpoint_flow_sessions_.find(next_remote_endpoint));
-    if (r_ep_flow_it != remote_endpoint_flow_sessions_.end()) {
-      typename FlowSessionsMap::const_iterator session_it(
-          r_ep_flow_it->second.find(socket_id));
-      if (session_it != r_ep_flow_it->second.end()) {
-        session_optional.reset(session_it->second);
-      }
-    }
-
-    return session_optional;
-  }
-
   FlowPtr GetFlow(const NextEndpoint &next_remote_endpoint) {
     boost::recursive_mutex::scoped_lock lock_flows(flows_mutex_);
     typename FlowsMap::const_iterator flow_it(
@@ -375,7 +959,12 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
       return flow_it->second;
     }
 
-    FlowPtr p_flow(Flow<Protocol>::Create(timer_io_service_));
+    FlowPtr p_flow(Flow<Protocol>::Create(
+        NextTimerIoService(), options_.send_batch_size,
+        boost::chrono::microseconds(options_.pacing_spin_time),
+        boost::chrono::microseconds(
+            tx_time_.load() ? options_.tx_time_horizon : 0),
+        options_.shared_congestion_enabled));
     flows_[next_remote_endpoint] = p_flow;
 
     return p_flow;
@@ -393,19 +982,40 @@ class Multiplexer : public std::enable_shared_from_this<Multiplexer<Protocol>> {
 
  private:
   MultiplexerManager *p_manager_;
+  MultiplexerOptions options_;
+  /// Index among the multiplexers sharing the local endpoint
+  uint32_t shard_;
+  uint32_t shards_count_;
+  boost::asio::io_service &io_service_;
+  std::unique_ptr<boost::asio::io_service::work> p_application_work_;
   NextSocket socket_;
-  boost::asio::io_service timer_io_service_;
-  std::unique_ptr<boost::asio::io_service::work> p_worker_;
-  boost::thread_group timer_threads_;
+  TimerPool::Ptr p_timer_pool_;
+  boost::asio::io_service &timer_io_service_;
   std::atomic<bool> running_;
   boost::recursive_mutex flows_mutex_;
   FlowsMap flows_;
   boost::recursive_mutex sessions_mutex_;
-  RemoteEndpointFlowMap remote_endpoint_flow_sessions_;
+  /// Lock free lookup on receive, written under sessions_mutex_
+  SessionTable sessions_;
+  RemoteEndpointSessionsMap remote_endpoint_sessions_;
   boost::recursive_mutex acceptor_mutex_;
   AcceptorSessionPtr p_acceptor_;
   boost::random::mt19937 gen_;
+  ReceivePool receive_pool_;
+  std::unique_ptr<ReceiveBatch> p_receive_batch_;
+  std::unique_ptr<CoalescedReceiveBatch> p_coalesced_receive_batch_;
+  std::unique_ptr<UringReceiver> p_uring_receiver_;
+  /// Reads carry SO_TIMESTAMPNS control messages
+  bool receive_timestamps_;
+  boost::mutex send_batch_mutex_;
+  std::unique_ptr<SendBatch> p_send_batch_;
+  bool flush_pending_;
+  io::TxTimeConverter tx_time_converter_;
+  /// Flows stamp departure times instead of waiting for them
+  std::atomic<bool> tx_time_;
   std::atomic<uint32_t> sent_count_;
+  std::atomic<uint32_t> received_count_;
+  std::atomic<uint32_t> receive_wakeup_count_;
 };
 
 }  // connected_protocol
@@ -0,0 +1,116 @@
+#ifndef UDT_CONNECTED_PROTOCOL_MULTIPLEXER_OPTIONS_H_
+#define UDT_CONNECTED_PROTOCOL_MULTIPLEXER_OPTIONS_H_
+
+#include <cstdint>
+
+#include <vector>
+
+namespace connected_protocol {
+
+/// Settings applied to every multiplexer created by a MultiplexerManager
+struct MultiplexerOptions {
+  MultiplexerOptions()
+      : receive_batch_size(32),
+        send_batch_size(32),
+        gso_enabled(false),
+        gro_enabled(false),
+        reuseport_shards(1),
+        io_uring_enabled(false),
+        receive_timestamps_enabled(false),
+        pacing_spin_time(20),
+        tx_time_enabled(false),
+        tx_time_horizon(1000),
+        shared_congestion_enabled(false),
+        timer_threads(1),
+        timer_threads_cpus(),
+        client_multiplexers(0),
+        serialized_sessions(false),
+        thread_per_core(false) {}
+
+  /// Maximum datagrams drained from the UDP socket per readiness event
+  /// (recvmmsg on Linux). 1 falls back to one async_receive_from per datagram
+  uint32_t receive_batch_size;
+
+  /// Maximum data packets pulled by a flow per wakeup and gathered into one
+  /// sendmmsg call on Linux. 1 sends each packet with its own async_send_to
+  uint32_t send_batch_size;
+
+  /// Coalesce up to 64 consecutive same size data packets to one peer of a
+  /// send batch into a single UDP_SEGMENT (GSO) message on Linux. Disabled
+  /// when the kernel rejects it. Requires send_batch_size > 1
+  bool gso_enabled;
+
+  /// Let the kernel coalesce received datagrams of a peer (UDP_GRO on Linux).
+  /// Coalesced reads use 64KB slots, at most 8 per receive batch
+  bool gro_enabled;
+
+  /// Number of SO_REUSEPORT sockets (and multiplexers) bound to an acceptor
+  /// local endpoint. Each shard has its own receive loop, session table and
+  /// timer thread. Packets are steered to the shard owning their destination
+  /// socket id, connection requests are spread by the kernel
+  uint32_t reuseport_shards;
+
+  /// Receive through io_uring (Linux 6.0): one multishot recvmsg stays armed
+  /// on the socket with a ring of max(64, receive_batch_size) provided
+  /// buffers. Falls back to socket reads when the kernel refuses it
+  bool io_uring_enabled;
+
+  /// Stamp received datagrams in the kernel (SO_TIMESTAMPNS on Linux) and use
+  /// these times for the packet arrival speed and link capacity estimates.
+  /// Read with batched or io_uring receives only
+  bool receive_timestamps_enabled;
+
+  /// Micro seconds before a packet is due from which the flow stops waiting
+  /// on its timer and yields until sending time (timers overshoot short
+  /// waits). 0 only uses the timer
+  uint32_t pacing_spin_time;
+
+  /// Let the kernel pace data packets (SO_TXTIME on Linux, with the fq qdisc
+  /// on the egress interface): flows hand packets over up to tx_time_horizon
+  /// ahead of time, each stamped with its departure time. Requires
+  /// send_batch_size > 1. Falls back to timer pacing when the kernel
+  /// refuses it
+  bool tx_time_enabled;
+
+  /// Micro seconds ahead of their departure time packets are handed to the
+  /// kernel with tx_time_enabled
+  uint32_t tx_time_horizon;
+
+  /// Sessions to the same remote endpoint share one sending rate, divided by
+  /// their send weight, instead of each probing the path. New sessions start
+  /// at the rate already learned instead of slow start
+  bool shared_congestion_enabled;
+
+  /// Threads running the pacing and protocol timers of every multiplexer.
+  /// Flows and sessions are spread across them. Read when a multiplexer is
+  /// created : a larger value gives the next multiplexers a larger pool
+  uint32_t timer_threads;
+
+  /// CPUs the timer threads are pinned to, in turn (Linux). Empty does not
+  /// pin them
+  std::vector<uint32_t> timer_threads_cpus;
+
+  /// Multiplexers (UDP sockets on ephemeral ports) shared by the outbound
+  /// connections of an io_service, used in turn. 0 gives each connection
+  /// its own multiplexer
+  uint32_t client_multiplexers;
+
+  /// Run all the protocol work of a session (datagrams, pacing, timers, user
+  /// ops) on the thread of its flow, without locking its sender, receiver
+  /// and sequence generators. Received datagrams are handed to that thread
+  /// in receive slots, or dispatched in place with thread_per_core
+  bool serialized_sessions;
+
+  /// Shared-nothing runtime: each multiplexer lives on one timer thread,
+  /// which runs its UDP socket, session table, receive buffers, flows and
+  /// sessions. Shard i of a reuseport endpoint is on timer thread i (the
+  /// pool gets at least reuseport_shards threads, pinned with
+  /// timer_threads_cpus). Only completion handlers cross threads, posted to
+  /// the application io_service. Pair with serialized_sessions to run
+  /// sessions without locks
+  bool thread_per_core;
+};
+
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_MULTIPLEXER_OPTIONS_H_
@@ -1,13 +1,19 @@
 #ifndef UDT_CONNECTED_PROTOCOL_MULTIPLEXERS_MANAGER_H_
 #define UDT_CONNECTED_PROTOCOL_MULTIPLEXERS_MANAGER_H_
 
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <vector>
+
+#include <boost/asio/detail/socket_option.hpp>
+#include <boost/asio/detail/socket_types.hpp>
 
 #include <boost/log/trivial.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include "udt/connected_protocol/multiplexer.h"
+#include "udt/connected_protocol/multiplexer_options.h"
 
 namespace connected_protocol {
 
@@ -19,65 +25,303 @@ class MultiplexerManager {
 
  private:
   typedef typename Multiplexer<Protocol>::Ptr MultiplexerPtr;
-  typedef std::map<NextLayerEndpoint, MultiplexerPtr> MultiplexersMap;
+
+ public:
+  /// Multiplexers sharing a local endpoint, indexed by shard
+  typedef std::vector<MultiplexerPtr> MultiplexerShards;
+
+ private:
+  /// Multiplexers of a local endpoint, stopped together when all are idle
+  struct MultiplexerGroup {
+    MultiplexerShards shards;
+    std::vector<bool> idle_shards;
+  };
+  typedef std::map<NextLayerEndpoint, MultiplexerGroup> MultiplexersMap;
+
+  /// Multiplexers shared by outbound connections of an io_service
+  struct ClientMultiplexers {
+    ClientMultiplexers() : multiplexers(), next(0) {}
+
+    std::vector<MultiplexerPtr> multiplexers;
+    std::size_t next;
+  };
+  typedef std::map<boost::asio::io_service *, ClientMultiplexers>
+      ClientMultiplexersMap;
+
+#if defined(SO_REUSEPORT)
+  typedef boost::asio::detail::socket_option::boolean<
+      BOOST_ASIO_OS_DEF(SOL_SOCKET), SO_REUSEPORT> reuse_port;
+#endif  // defined(SO_REUSEPORT)
 
   // TODO move multiplexers management in service
  public:
-  MultiplexerManager() : mutex_(), multiplexers_() {}
+  MultiplexerManager()
+      : mutex_(),
+        options_(),
+        multiplexers_(),
+        client_multiplexers_(),
+        p_timer_pool_(nullptr) {}
+
+  /// Options used by multiplexers created from now on (timer pool options
+  /// are read when a multiplexer is created and needs more threads than the
+  /// pool has)
+  void set_options(const MultiplexerOptions &options) {
+    boost::mutex::scoped_lock lock(mutex_);
+    options_ = options;
+  }
+
+  MultiplexerOptions options() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return options_;
+  }
 
   MultiplexerPtr GetMultiplexer(const NextLayerEndpoint &next_local_endpoint) {
     boost::mutex::scoped_lock lock(mutex_);
     auto multiplexer_it = multiplexers_.find(next_local_endpoint);
     if (multiplexer_it != multiplexers_.end()) {
-      return multiplexer_it->second;
+      return multiplexer_it->second.shards.front();
     }
 
     return nullptr;
   }
 
+  /// Get or create a single multiplexer on the local endpoint
   MultiplexerPtr CreateMultiplexer(boost::asio::io_service &io_service,
                                    const NextLayerEndpoint &next_local_endpoint,
                                    boost::system::error_code &ec) {
     boost::mutex::scoped_lock lock(mutex_);
     auto multiplexer_it = multiplexers_.find(next_local_endpoint);
     if (multiplexer_it == multiplexers_.end()) {
-      NextSocket next_layer_socket(io_service);
-      next_layer_socket.open(next_local_endpoint.protocol());
-      // Empty endpoint will bind the socket to an available port
-      next_layer_socket.bind(next_local_endpoint, ec);
+      MultiplexerShards shards(
+          CreateShards(io_service, next_local_endpoint, 1, ec));
       if (ec) {
-        BOOST_LOG_TRIVIAL(error)
-            << "Could not bind multiplexer on local endpoint";
         return nullptr;
       }
 
-      MultiplexerPtr p_multiplexer =
-          Multiplexer<Protocol>::Create(this, std::move(next_layer_socket));
+      return shards.front();
+    }
 
-      boost::system::error_code ec;
+    return multiplexer_it->second.shards.front();
+  }
 
-      multiplexers_[p_multiplexer->local_endpoint(ec)] = p_multiplexer;
-      p_multiplexer->Start();
+  /// Get a multiplexer for an outbound connection
+  /**
+  * With client_multiplexers > 0, connections of an io_service share up to
+  * client_multiplexers multiplexers bound to ephemeral ports, created on
+  * demand then used in turn. Otherwise each connection gets its own
+  * multiplexer.
+  */
+  MultiplexerPtr GetClientMultiplexer(boost::asio::io_service &io_service,
+                                      boost::system::error_code &ec) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (options_.client_multiplexers == 0) {
+      MultiplexerShards shards(
+          CreateShards(io_service, NextLayerEndpoint(), 1, ec));
+      return ec ? nullptr : shards.front();
+    }
+
+    ClientMultiplexers &clients = client_multiplexers_[&io_service];
+    if (clients.multiplexers.size() < options_.client_multiplexers) {
+      MultiplexerShards shards(
+          CreateShards(io_service, NextLayerEndpoint(), 1, ec));
+      if (ec) {
+        return nullptr;
+      }
+      clients.multiplexers.push_back(shards.front());
+      return shards.front();
+    }
+
+    return clients.multiplexers[clients.next++ % clients.multiplexers.size()];
+  }
+
+  /// Get or create the multiplexers listening on the local endpoint
+  /**
+  * With reuseport_shards > 1, as many SO_REUSEPORT sockets are bound to the
+  * endpoint, each one with its own multiplexer. Packets are steered to the
+  * shard encoded in their destination socket id, or spread by the kernel
+  * when the id is not known yet (handshake).
+  */
+  MultiplexerShards CreateMultiplexerShards(
+      boost::asio::io_service &io_service,
+      const NextLayerEndpoint &next_local_endpoint,
+      boost::system::error_code &ec) {
+    boost::mutex::scoped_lock lock(mutex_);
+    auto multiplexer_it = multiplexers_.find(next_local_endpoint);
+    if (multiplexer_it != multiplexers_.end()) {
+      auto &group = multiplexer_it->second;
+      group.idle_shards.assign(group.shards.size(), false);
+      return group.shards;
+    }
 
-      return p_multiplexer;
+    uint32_t shards_count(std::max<uint32_t>(1, options_.reuseport_shards));
+#if !defined(SO_REUSEPORT)
+    if (shards_count > 1) {
+      BOOST_LOG_TRIVIAL(trace)
+          << "SO_REUSEPORT not available, one multiplexer per local endpoint";
+      shards_count = 1;
     }
+#endif  // !defined(SO_REUSEPORT)
 
-    return multiplexer_it->second;
+    return CreateShards(io_service, next_local_endpoint, shards_count, ec);
   }
 
-  void CleanMultiplexer(const NextLayerEndpoint &next_local_endpoint) {
+  /// Stop the multiplexer once it has no session nor acceptor
+  /**
+  * Sharded multiplexers are only stopped together, when all of them are idle:
+  * closing one socket would reorder the kernel reuseport group and break
+  * socket id steering.
+  */
+  void CleanMultiplexer(const NextLayerEndpoint &next_local_endpoint,
+                        uint32_t shard = 0) {
     boost::mutex::scoped_lock lock(mutex_);
-    if (multiplexers_.find(next_local_endpoint) != multiplexers_.end()) {
+    auto multiplexer_it = multiplexers_.find(next_local_endpoint);
+    if (multiplexer_it == multiplexers_.end()) {
+      return;
+    }
+
+    auto &group = multiplexer_it->second;
+    if (shard >= group.shards.size()) {
+      return;
+    }
+
+    group.idle_shards[shard] = true;
+    for (bool idle_shard : group.idle_shards) {
+      if (!idle_shard) {
+        return;
+      }
+    }
+
+    for (auto &p_multiplexer : group.shards) {
       boost::system::error_code ec;
-      multiplexers_[next_local_endpoint]->Stop(ec);
-      multiplexers_.erase(next_local_endpoint);
+      p_multiplexer->Stop(ec);
       // @todo should ec be swallowed here?
+      RemoveClientMultiplexer(p_multiplexer);
+    }
+    multiplexers_.erase(multiplexer_it);
+  }
+
+ private:
+  void RemoveClientMultiplexer(const MultiplexerPtr &p_multiplexer) {
+    for (auto clients_it = client_multiplexers_.begin();
+         clients_it != client_multiplexers_.end(); ++clients_it) {
+      auto &multiplexers = clients_it->second.multiplexers;
+      auto multiplexer_it =
+          std::find(multiplexers.begin(), multiplexers.end(), p_multiplexer);
+      if (multiplexer_it == multiplexers.end()) {
+        continue;
+      }
+      multiplexers.erase(multiplexer_it);
+      if (multiplexers.empty()) {
+        client_multiplexers_.erase(clients_it);
+      }
+      return;
+    }
+  }
+
+  MultiplexerShards CreateShards(boost::asio::io_service &io_service,
+                                 const NextLayerEndpoint &next_local_endpoint,
+                                 uint32_t shards_count,
+                                 boost::system::error_code &ec) {
+    PrepareTimerPool(shards_count);
+
+    MultiplexerShards shards;
+    // Empty endpoint will bind the first socket to an available port, others
+    // share it
+    NextLayerEndpoint bound_endpoint(next_local_endpoint);
+    for (uint32_t shard = 0; shard < shards_count; ++shard) {
+      MultiplexerPtr p_multiplexer(CreateShard(io_service, bound_endpoint,
+                                               shard, shards_count, ec));
+      if (ec) {
+        for (auto &p_created_multiplexer : shards) {
+          boost::system::error_code stop_ec;
+          p_created_multiplexer->Stop(stop_ec);
+        }
+        return MultiplexerShards();
+      }
+      if (shard == 0) {
+        bound_endpoint = p_multiplexer->local_endpoint(ec);
+      }
+      shards.push_back(p_multiplexer);
+    }
+
+    MultiplexerGroup &group = multiplexers_[bound_endpoint];
+    group.shards = shards;
+    group.idle_shards.assign(shards_count, false);
+    for (auto &p_multiplexer : shards) {
+      p_multiplexer->Start();
+    }
+
+    return shards;
+  }
+
+  /// Create the timer pool of new multiplexers, or a larger one when
+  /// timer_threads or thread per core shards outnumber its threads. Existing
+  /// multiplexers keep the pool they run on
+  void PrepareTimerPool(uint32_t shards_count) {
+    bool thread_per_shard(options_.thread_per_core && shards_count > 1);
+    uint32_t required_count(
+        std::max(options_.timer_threads, thread_per_shard ? shards_count : 1));
+    if (p_timer_pool_ && p_timer_pool_->size() >= required_count) {
+      return;
+    }
+
+    uint32_t threads_count(options_.timer_threads);
+    if (options_.thread_per_core) {
+      threads_count = std::max(
+          threads_count, std::max(options_.reuseport_shards, shards_count));
+    }
+    if (p_timer_pool_) {
+      BOOST_LOG_TRIVIAL(trace)
+          << "Multiplexer manager : timer pool grown from "
+          << p_timer_pool_->size() << " to " << threads_count << " threads";
     }
+    p_timer_pool_ =
+        TimerPool::Create(threads_count, options_.timer_threads_cpus);
+  }
+
+  MultiplexerPtr CreateShard(boost::asio::io_service &io_service,
+                             const NextLayerEndpoint &next_local_endpoint,
+                             uint32_t shard, uint32_t shards_count,
+                             boost::system::error_code &ec) {
+    // Thread per core : shard i lives on pool thread i, single multiplexers
+    // on the pool threads in turn
+    boost::asio::io_service &timer_io_service(
+        options_.thread_per_core && shards_count > 1
+            ? p_timer_pool_->io_service(shard)
+            : p_timer_pool_->NextIoService());
+
+    NextSocket next_layer_socket(options_.thread_per_core ? timer_io_service
+                                                          : io_service);
+    next_layer_socket.open(next_local_endpoint.protocol());
+#if defined(SO_REUSEPORT)
+    if (shards_count > 1) {
+      next_layer_socket.set_option(reuse_port(true), ec);
+      if (ec) {
+        BOOST_LOG_TRIVIAL(error) << "Could not share multiplexer local "
+                                    "endpoint (SO_REUSEPORT)";
+        return nullptr;
+      }
+    }
+#endif  // defined(SO_REUSEPORT)
+    next_layer_socket.bind(next_local_endpoint, ec);
+    if (ec) {
+      BOOST_LOG_TRIVIAL(error)
+          << "Could not bind multiplexer on local endpoint";
+      return nullptr;
+    }
+
+    return Multiplexer<Protocol>::Create(
+        this, io_service, std::move(next_layer_socket), p_timer_pool_,
+        timer_io_service, options_, shard, shards_count);
   }
 
  private:
   boost::mutex mutex_;
+  MultiplexerOptions options_;
   MultiplexersMap multiplexers_;
+  ClientMultiplexersMap client_multiplexers_;
+  // shared by every multiplexer, for the lifetime of the manager
+  TimerPool::Ptr p_timer_pool_;
 };
 
 }  // connected_protocol
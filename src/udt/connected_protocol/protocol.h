@@ -20,6 +20,8 @@
 #include "udt/connected_protocol/datagram/basic_datagram.h"
 #include "udt/connected_protocol/datagram/basic_header.h"
 #include "udt/connected_protocol/datagram/basic_payload.h"
+#include "udt/connected_protocol/datagram/control_view.h"
+#include "udt/connected_protocol/datagram/data_view.h"
 #include "udt/connected_protocol/datagram/empty_component.h"
 
 #include "udt/connected_protocol/endpoint.h"
@@ -59,10 +61,11 @@ class Protocol {
   typedef boost::asio::basic_waitable_timer<clock> timer;
 
   // Socket options
-  enum socket_options { TIMEOUT_DELAY };
+  enum socket_options { TIMEOUT_DELAY, SEND_WEIGHT, SEND_PRIORITY, SEND_COPY };
 
   enum : uint32_t {
     MTU = 1500,
+    MAX_COALESCED_DATAGRAM_SIZE = 65535,
     MAXIMUM_WINDOW_FLOW_SIZE = 25600,
     MAX_PACKET_SEQUENCE_NUMBER = 0x7FFFFFFF,
     MAX_ACK_SEQUENCE_NUMBER = 0x1FFFFFFF,
@@ -74,6 +77,21 @@ class Protocol {
   typedef boost::asio::detail::socket_option::integer<
       BOOST_ASIO_OS_DEF(SOL_SOCKET), TIMEOUT_DELAY> timeout_option_type;
 
+  /// Weight of the socket in the fair queueing of the sockets to the same
+  /// remote endpoint (1 by default)
+  typedef boost::asio::detail::socket_option::integer<
+      BOOST_ASIO_OS_DEF(SOL_SOCKET), SEND_WEIGHT> send_weight_option_type;
+
+  /// Strict priority over the other sockets to the same remote endpoint
+  typedef boost::asio::detail::socket_option::boolean<
+      BOOST_ASIO_OS_DEF(SOL_SOCKET), SEND_PRIORITY> send_priority_option_type;
+
+  /// Copy written data into packets and complete writes once queued,
+  /// instead of sending from the caller buffers and completing writes once
+  /// acknowledged (false by default)
+  typedef boost::asio::detail::socket_option::boolean<
+      BOOST_ASIO_OS_DEF(SOL_SOCKET), SEND_COPY> send_copy_option_type;
+
   typedef Endpoint<Protocol> endpoint;
 
   typedef Resolver<Protocol> resolver;
@@ -108,10 +126,16 @@ class Protocol {
       GenericReceivePayload;
   typedef datagram::ConstBufferSequencePayload<MTU - GenericHeader::size>
       SendPayload;
+  typedef datagram::BufferPayload<MAX_COALESCED_DATAGRAM_SIZE -
+                                  GenericHeader::size>
+      CoalescedReceivePayload;
 
   // Generic datagram type
   typedef datagram::basic_Datagram<GenericHeader, GenericReceivePayload>
       GenericReceiveDatagram;
+  // Several datagrams of a peer coalesced by the kernel (UDP GRO)
+  typedef datagram::basic_Datagram<GenericHeader, CoalescedReceivePayload>
+      CoalescedReceiveDatagram;
 
   // Control datagram types
   typedef datagram::basic_Datagram<ControlHeader, ConnectionPayload>
@@ -130,12 +154,25 @@ class Protocol {
   typedef datagram::basic_Datagram<ControlHeader, GenericReceivePayload>
       GenericControlDatagram;
 
+  // Read-only control datagram views on receive buffers
+  typedef datagram::basic_ControlView ControlView;
+  typedef ControlView KeepAliveView;
+  typedef ControlView ShutdownView;
+  typedef ControlView AckOfAckView;
+  typedef datagram::basic_ControlDatagramView<datagram::basic_AckPayloadView>
+      AckView;
+  typedef datagram::basic_ControlDatagramView<datagram::basic_NAckPayloadView>
+      NAckView;
+  typedef datagram::basic_ControlDatagramView<
+      datagram::basic_MessageDropRequestPayloadView> MessageDropRequestView;
+
   // Data datagram
   typedef datagram::basic_Datagram<DataHeader, GenericReceivePayload>
       DataDatagram;
-  typedef datagram::basic_Datagram<DataHeader, GenericReceivePayload>
-      SendDatagram;
+  typedef datagram::basic_Datagram<DataHeader, SendPayload> SendDatagram;
   typedef DataDatagram ReceiveDatagram;
+  // Read-only data datagram view on receive buffers
+  typedef datagram::basic_DataView DataView;
 
  public:
   static MultiplexerManager<Protocol> multiplexers_manager_;
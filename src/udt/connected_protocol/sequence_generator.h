@@ -9,11 +9,11 @@
 #include <boost/chrono.hpp>
 #include <boost/log/trivial.hpp>
 
-#include <boost/thread/mutex.hpp>
-
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
 
+#include "udt/connected_protocol/common/session_mutex.h"
+
 namespace connected_protocol {
 
 class SequenceGenerator {
@@ -21,8 +21,11 @@ class SequenceGenerator {
   typedef uint32_t SeqNumber;
 
  public:
-  SequenceGenerator(SeqNumber max_value)
-      : mutex_(), current_(0), max_value_(max_value) {
+  /**
+  * @param serialized Only used from the thread of a serialized session
+  */
+  SequenceGenerator(SeqNumber max_value, bool serialized = false)
+      : mutex_(serialized), current_(0), max_value_(max_value) {
     boost::random::mt19937 gen(static_cast<SeqNumber>(
         boost::chrono::duration_cast<boost::chrono::nanoseconds>(
             boost::chrono::high_resolution_clock::now().time_since_epoch())
@@ -33,19 +36,19 @@ class SequenceGenerator {
   }
 
   uint32_t Previous() {
-    boost::mutex::scoped_lock lock(mutex_);
+    common::SessionMutex::scoped_lock lock(mutex_);
     current_ = Dec(current_);
     return current_;
   }
 
   uint32_t Next() {
-    boost::mutex::scoped_lock lock(mutex_);
+    common::SessionMutex::scoped_lock lock(mutex_);
     current_ = Inc(current_);
     return current_;
   }
 
   void set_current(uint32_t current) {
-    boost::mutex::scoped_lock lock(mutex_);
+    common::SessionMutex::scoped_lock lock(mutex_);
     if (current > max_value_) {
       current_ = 0;
     } else {
@@ -54,7 +57,7 @@ class SequenceGenerator {
   }
 
   uint32_t current() {
-    boost::mutex::scoped_lock lock(mutex_);
+    common::SessionMutex::scoped_lock lock(mutex_);
     return current_;
   }
 
@@ -98,7 +101,7 @@ class SequenceGenerator {
   }
 
  private:
-  boost::mutex mutex_;
+  common::SessionMutex mutex_;
   SeqNumber current_;
   SeqNumber max_value_;
   SeqNumber threshold_compare_;
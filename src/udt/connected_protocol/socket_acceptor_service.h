@@ -151,14 +151,20 @@ class socket_acceptor_service : public boost::asio::detail::service_base<
       return ec;
     }
 
-    p_multiplexer_type p_multiplexer =
-        protocol_type::multiplexers_manager_.CreateMultiplexer(
+    auto multiplexers =
+        protocol_type::multiplexers_manager_.CreateMultiplexerShards(
             this->get_io_service(), endpoint.next_layer_endpoint(), ec);
     if (ec) {
       return ec;
     }
 
-    p_multiplexer->SetAcceptor(ec, impl);
+    // Accept from every multiplexer sharing the endpoint
+    for (auto& p_multiplexer : multiplexers) {
+      p_multiplexer->SetAcceptor(ec, impl);
+      if (ec) {
+        return ec;
+      }
+    }
 
     return ec;
   }
@@ -61,10 +61,12 @@ class SocketSession
   typedef typename Protocol::GenericControlDatagram ControlDatagram;
   typedef typename ControlDatagram::Header ControlHeader;
   typedef std::shared_ptr<ControlDatagram> ControlDatagramPtr;
+  typedef typename Protocol::ControlView ControlView;
   typedef typename Protocol::SendDatagram SendDatagram;
   typedef std::shared_ptr<SendDatagram> SendDatagramPtr;
   typedef typename Protocol::DataDatagram DataDatagram;
   typedef std::shared_ptr<DataDatagram> DataDatagramPtr;
+  typedef typename Protocol::DataView DataView;
   typedef typename Protocol::AckDatagram AckDatagram;
   typedef std::shared_ptr<AckDatagram> AckDatagramPtr;
   typedef typename Protocol::AckOfAckDatagram AckOfAckDatagram;
@@ -112,33 +114,61 @@ class SocketSession
   }
 
   void Close() {
+    if (serialized_) {
+      auto self = this->shared_from_this();
+      timer_io_service_.post([self]() { self->p_state_->Close(); });
+      return;
+    }
     auto p_state = p_state_;
     p_state_->Close();
   }
 
   void PushReadOp(io::basic_pending_stream_read_operation<Protocol>* read_op) {
+    if (serialized_) {
+      auto self = this->shared_from_this();
+      timer_io_service_.post(
+          [self, read_op]() { self->p_state_->PushReadOp(read_op); });
+      return;
+    }
     auto p_state = p_state_;
     p_state_->PushReadOp(read_op);
   }
 
   void PushWriteOp(io::basic_pending_write_operation* write_op) {
+    if (serialized_) {
+      auto self = this->shared_from_this();
+      timer_io_service_.post(
+          [self, write_op]() { self->p_state_->PushWriteOp(write_op); });
+      return;
+    }
     auto p_state = p_state_;
     p_state_->PushWriteOp(write_op);
   }
 
   void PushConnectionDgr(ConnectionDatagramPtr p_connection_dgr) {
+    if (serialized_) {
+      auto self = this->shared_from_this();
+      timer_io_service_.post([self, p_connection_dgr]() {
+        self->p_state_->OnConnectionDgr(p_connection_dgr);
+      });
+      return;
+    }
     auto p_state = p_state_;
     p_state_->OnConnectionDgr(p_connection_dgr);
   }
 
-  void PushControlDgr(ControlDatagram* p_control_dgr) {
+  /// The view must be processed before the dispatch returns : the
+  /// multiplexer calls it on the protocol thread of serialized sessions
+  void PushControlDgr(const ControlView& control_view) {
     auto p_state = p_state_;
-    p_state_->OnControlDgr(p_control_dgr);
+    p_state_->OnControlDgr(control_view);
   }
 
-  void PushDataDgr(DataDatagram* p_datagram) {
+  /// The view must be processed before the dispatch returns : the
+  /// multiplexer calls it on the protocol thread of serialized sessions
+  void PushDataDgr(const DataView& data_view) {
     auto p_state = p_state_;
-    p_state_->OnDataDgr(p_datagram);
+    p_state_->OnDataDgr(data_view);
   }
 
   bool HasPacketToSend() {
@@ -151,7 +181,7 @@ class SocketSession
     return p_state_->NextScheduledPacket();
   }
 
-  boost::chrono::nanoseconds NextScheduledPacketTime() {
+  TimePoint NextScheduledPacketTime() {
     auto p_state = p_state_;
     return p_state_->NextScheduledPacketTime();
   }
@@ -172,6 +202,13 @@ class SocketSession
                                         handler);
   }
 
+  // Send through the multiplexer send batch, not before departure_time if set
+  void QueueSendPacket(SendDatagram* p_datagram,
+                       const TimePoint& departure_time = TimePoint()) {
+    p_multiplexer_->QueueDataPacket(p_datagram, next_remote_endpoint_,
+                                    departure_time);
+  }
+
   // State management
   void AddObserver(SessionObserverPtr p_observer) {
     boost::recursive_mutex::scoped_lock lock(mutex);
@@ -206,8 +243,16 @@ class SocketSession
 
   uint32_t get_window_flow_size() { return window_flow_size.load(); }
 
-  boost::asio::io_service& get_timer_io_service() {
-    return p_multiplexer_->get_timer_io_service();
+  boost::asio::io_service& get_timer_io_service() { return timer_io_service_; }
+
+  /// All the protocol work of the session runs on one thread
+  bool serialized() const { return serialized_; }
+
+  /// io_service running the protocol handlers of the session (datagrams,
+  /// write ops, read queues) : the flow thread when serialized, the
+  /// multiplexer io_service otherwise
+  boost::asio::io_service& get_protocol_io_service() {
+    return serialized_ ? timer_io_service_ : get_io_service();
   }
 
   boost::asio::io_service& get_io_service() {
@@ -217,19 +262,28 @@ class SocketSession
  private:
   SocketSession(MultiplexerPtr p_multiplexer, FlowPtr p_fl)
       : p_flow(std::move(p_fl)),
-        message_seq_gen(Protocol::MAX_MSG_SEQUENCE_NUMBER),
-        packet_seq_gen(Protocol::MAX_PACKET_SEQUENCE_NUMBER),
-        ack_seq_gen(Protocol::MAX_ACK_SEQUENCE_NUMBER),
+        message_seq_gen(Protocol::MAX_MSG_SEQUENCE_NUMBER,
+                        p_multiplexer->options().serialized_sessions),
+        packet_seq_gen(Protocol::MAX_PACKET_SEQUENCE_NUMBER,
+                       p_multiplexer->options().serialized_sessions),
+        ack_seq_gen(Protocol::MAX_ACK_SEQUENCE_NUMBER,
+                    p_multiplexer->options().serialized_sessions),
         syn_cookie(0),
         socket_id(0),
         remote_socket_id(0),
         timeout_delay(60),
+        send_weight(1),
+        send_priority(false),
+        send_copy(false),
         max_window_flow_size(0),
         window_flow_size(0),
         p_multiplexer_(std::move(p_multiplexer)),
+        serialized_(p_multiplexer_->options().serialized_sessions),
+        timer_io_service_(serialized_ ? p_flow->get_io_service()
+                                      : p_multiplexer_->NextTimerIoService()),
         observers_(),
         p_state_(ClosedState::Create(p_multiplexer_->get_io_service())),
-        logger_timer_(p_multiplexer_->get_timer_io_service()),
+        logger_timer_(timer_io_service_),
         logger_() {
     // initialize local endpoint with multiplexer's one
     boost::system::error_code ec;
@@ -310,6 +364,12 @@ class SocketSession
   SocketId remote_socket_id;
   PacketSequenceNumber init_packet_seq_num;
   int timeout_delay;
+  // share of the flow given to this socket among due sockets
+  std::atomic<uint32_t> send_weight;
+  // served before every other socket of the flow when due
+  std::atomic<bool> send_priority;
+  // writes are copied and complete when queued instead of on acknowledgement
+  std::atomic<bool> send_copy;
   boost::recursive_mutex mutex;
   uint32_t max_window_flow_size;
   std::atomic<uint32_t> window_flow_size;
@@ -318,6 +378,10 @@ class SocketSession
 
  private:
   MultiplexerPtr p_multiplexer_;
+  bool serialized_;
+  // runs the timers of the session, taken in turn from the timer pool or
+  // shared with the flow when serialized
+  boost::asio::io_service& timer_io_service_;
   std::set<SessionObserverPtr> observers_;
   BaseStatePtr p_state_;
   NextLayerEndpoint next_local_endpoint_;
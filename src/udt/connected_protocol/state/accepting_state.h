@@ -123,7 +123,7 @@ class AcceptingState
  private:
   AcceptingState(typename SocketSession::Ptr p_session)
       : p_session_(std::move(p_session)),
-        timeout_timer_(p_session_->get_io_service()) {}
+        timeout_timer_(p_session_->get_protocol_io_service()) {}
 
   void StartTimeoutTimer() {
     timeout_timer_.expires_from_now(
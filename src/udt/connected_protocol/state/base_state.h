@@ -22,6 +22,8 @@ class BaseState {
   typedef std::shared_ptr<ConnectionDatagram> ConnectionDatagramPtr;
   typedef typename Protocol::GenericControlDatagram ControlDatagram;
   typedef std::shared_ptr<ControlDatagram> ControlDatagramPtr;
+  typedef typename Protocol::ControlView ControlView;
+  typedef typename Protocol::DataView DataView;
   typedef typename Protocol::SendDatagram SendDatagram;
   typedef std::shared_ptr<SendDatagram> SendDatagramPtr;
   typedef typename Protocol::DataDatagram DataDatagram;
@@ -77,11 +79,13 @@ class BaseState {
     // Drop dgr
   }
 
-  virtual void OnControlDgr(ControlDatagram* p_control_dgr) {
+  /// @param control_view Only valid during the call
+  virtual void OnControlDgr(const ControlView& control_view) {
     // Drop dgr
   }
 
-  virtual void OnDataDgr(DataDatagram* p_datagram) {
+  /// @param data_view Only valid during the call
+  virtual void OnDataDgr(const DataView& data_view) {
     // Drop dgr
   }
 
@@ -93,9 +97,8 @@ class BaseState {
 
   virtual double EstimatedLinkCapacity() { return 0.0; }
 
-  virtual boost::chrono::nanoseconds NextScheduledPacketTime() {
-    return boost::chrono::nanoseconds(0);
-  }
+  /// @return time the next data packet is due
+  virtual TimePoint NextScheduledPacketTime() { return Clock::now(); }
 };
 
 }  // state
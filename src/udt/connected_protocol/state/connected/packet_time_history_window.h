@@ -16,9 +16,11 @@ namespace state {
 namespace connected {
 
 class PacketTimeHistoryWindow {
- private:
+ public:
   typedef boost::chrono::time_point<boost::chrono::high_resolution_clock>
       HighResolutionTimePoint;
+
+ private:
   typedef int_least64_t MicrosecUnit;
   typedef boost::circular_buffer<MicrosecUnit> CircularBuffer;
 
@@ -48,25 +50,21 @@ class PacketTimeHistoryWindow {
     }
   }
 
-  void OnArrival() {
+  /// @param arrival_time Kernel receive time of the packet if known
+  void OnArrival(const HighResolutionTimePoint &arrival_time) {
     boost::mutex::scoped_lock lock_arrival(arrival_mutex_);
-    HighResolutionTimePoint arrival_time(
-        boost::chrono::high_resolution_clock::now());
     MicrosecUnit delta(DeltaTime(arrival_time, last_arrival_));
     arrival_interval_history_.push_back(delta);
     last_arrival_ = arrival_time;
   }
 
-  void OnFirstProbe() {
+  void OnFirstProbe(const HighResolutionTimePoint &arrival_time) {
     boost::mutex::scoped_lock lock_probe(probe_mutex_);
-    first_probe_arrival_ = boost::chrono::high_resolution_clock::now();
+    first_probe_arrival_ = arrival_time;
   }
 
-  void OnSecondProbe() {
+  void OnSecondProbe(const HighResolutionTimePoint &arrival_time) {
     boost::mutex::scoped_lock lock_probe(probe_mutex_);
-    HighResolutionTimePoint arrival_time(
-        boost::chrono::high_resolution_clock::now());
-
     probe_interval_history_.push_back(
         DeltaTime(arrival_time, first_probe_arrival_));
   }
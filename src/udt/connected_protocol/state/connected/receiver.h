@@ -6,16 +6,16 @@
 #include <atomic>
 #include <map>
 #include <queue>
-#include <set>
 
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/basic_waitable_timer.hpp>
 
 #include <boost/chrono.hpp>
 #include <boost/log/trivial.hpp>
-#include <boost/thread/mutex.hpp>
 
 #include "udt/common/error/error.h"
+#include "udt/connected_protocol/common/sequence_interval_set.h"
+#include "udt/connected_protocol/common/session_mutex.h"
 #include "udt/connected_protocol/io/buffers.h"
 #include "udt/connected_protocol/io/read_op.h"
 #include "udt/connected_protocol/sequence_generator.h"
@@ -40,6 +40,7 @@ class Receiver {
   typedef typename Protocol::socket_session SocketSession;
   typedef typename Protocol::DataDatagram DataDatagram;
   typedef std::shared_ptr<DataDatagram> DataDatagramPtr;
+  typedef typename Protocol::DataView DataView;
   typedef typename Protocol::AckDatagram AckDatagram;
   typedef std::shared_ptr<AckDatagram> AckDatagramPtr;
   typedef typename Protocol::NAckDatagram NAckDatagram;
@@ -47,25 +48,27 @@ class Receiver {
 
   typedef std::map<packet_sequence_number_type, DataDatagram>
       ReceivedDatagramsMap;
+  typedef PacketTimeHistoryWindow::HighResolutionTimePoint PacketTimePoint;
+  typedef common::SessionMutex SessionMutex;
 
  public:
   Receiver(boost::asio::io_service &io_service,
            typename SocketSession::Ptr p_session)
-      : mutex_(),
+      : mutex_(p_session->serialized()),
         p_session_(std::move(p_session)),
         lrsn_(0),
-        loss_list_(),
-        read_ops_mutex_(),
+        loss_list_(p_session_->packet_seq_gen),
+        read_ops_mutex_(p_session_->serialized()),
         read_ops_queue_(),
         max_received_size_(8192),
-        packets_received_mutex_(),
+        packets_received_mutex_(p_session_->serialized()),
         packets_received_(),
         packet_history_window_(),
         ack_history_window_(),
         exp_count_(0) {}
 
   void Init(packet_sequence_number_type initial_packet_seq_num) {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     last_exp_reset_timestamp_ = Clock::now();
 
     lrsn_ = initial_packet_seq_num - 1;
@@ -87,29 +90,36 @@ class Receiver {
 
   void Stop() { CloseReadOpsQueue(); }
 
-  void OnDataDatagram(DataDatagram *p_datagram) {
-    boost::mutex::scoped_lock lock(mutex_);
+  /// The payload is copied only if the packet is stored for reading
+  void OnDataDatagram(const DataView &data_view) {
+    SessionMutex::scoped_lock lock(mutex_);
 
     auto &packet_seq_gen = p_session_->packet_seq_gen;
-    auto &header = p_datagram->header();
+    auto &header = data_view.header();
     packet_sequence_number_type packet_seq_num =
         header.packet_sequence_number();
 
+    // Kernel receive time when the multiplexer got one, now otherwise
+    PacketTimePoint arrival_time(data_view.arrival_time());
+    if (arrival_time == PacketTimePoint()) {
+      arrival_time = boost::chrono::high_resolution_clock::now();
+    }
+
     // Save packet arrival time in receiver history window
-    packet_history_window_.OnArrival();
+    packet_history_window_.OnArrival(arrival_time);
 
     // Register first packet probe arrival
     if (packet_seq_num % 16 == 0) {
-      packet_history_window_.OnFirstProbe();
+      packet_history_window_.OnFirstProbe(arrival_time);
     }
 
     // Register second packet probe arrival
     if (packet_seq_num % 16 == 1) {
-      packet_history_window_.OnSecondProbe();
+      packet_history_window_.OnSecondProbe(arrival_time);
     }
 
     {
-      boost::mutex::scoped_lock lock_packets_received(packets_received_mutex_);
+      SessionMutex::scoped_lock lock_packets_received(packets_received_mutex_);
       if (!packets_received_.empty()) {
         auto &begin_pair = *(packets_received_.begin());
         auto first_seq_num_received_buffer = begin_pair.first;
@@ -129,19 +139,16 @@ class Receiver {
 
     if (packet_seq_gen.Compare(packet_seq_num,
                                packet_seq_gen.Inc(lrsn_.load())) > 0) {
-      uint32_t i = packet_seq_gen.Inc(lrsn_.load());
-      while (i != packet_seq_num) {
-        loss_list_.insert(i);
-        i = packet_seq_gen.Inc(i);
-      }
+      auto loss_interval = loss_list_.Insert(
+          packet_seq_gen.Inc(lrsn_.load()), packet_seq_gen.Dec(packet_seq_num));
 
+      // NAck the stored interval
       NAckDatagramPtr p_nack_dgr = std::make_shared<NAckDatagram>();
-      if (packet_seq_gen.Inc(lrsn_.load()) !=
-          packet_seq_gen.Dec(packet_seq_num)) {
-        p_nack_dgr->payload().AddLossRange(packet_seq_gen.Inc(lrsn_.load()),
-                                           packet_seq_gen.Dec(packet_seq_num));
+      if (loss_interval.first != loss_interval.last) {
+        p_nack_dgr->payload().AddLossRange(loss_interval.first,
+                                           loss_interval.last);
       } else {
-        p_nack_dgr->payload().AddLossPacket(packet_seq_gen.Inc(lrsn_.load()));
+        p_nack_dgr->payload().AddLossPacket(loss_interval.first);
       }
       auto p_session = p_session_;
       // send nack datagram
@@ -151,7 +158,7 @@ class Receiver {
           [p_session, p_nack_dgr](const boost::system::error_code &,
                                   std::size_t) {});
     } else if (packet_seq_gen.Compare(packet_seq_num, lrsn_.load()) < 0) {
-      loss_list_.erase(packet_seq_num);
+      loss_list_.Erase(packet_seq_num);
     }
 
     if (packet_seq_gen.Compare(packet_seq_num, lrsn_.load()) > 0) {
@@ -159,12 +166,12 @@ class Receiver {
     }
 
     {
-      boost::mutex::scoped_lock lock_packets_received(packets_received_mutex_);
-      packets_received_[packet_seq_num] = std::move(*p_datagram);
+      SessionMutex::scoped_lock lock_packets_received(packets_received_mutex_);
+      data_view.CopyTo(&packets_received_[packet_seq_num]);
     }
 
-    p_session_->get_io_service().post(boost::bind(&Receiver::HandleQueues, this,
-                                                  boost::system::error_code()));
+    p_session_->get_protocol_io_service().post(boost::bind(
+        &Receiver::HandleQueues, this, boost::system::error_code()));
   }
 
   void StoreAck(ack_sequence_number_type ack_seq_num,
@@ -184,7 +191,7 @@ class Receiver {
 
   // @return buffer size in bytes
   uint32_t AvailableReceiveBufferSize() {
-    boost::mutex::scoped_lock lock(packets_received_mutex_);
+    SessionMutex::scoped_lock lock(packets_received_mutex_);
     return max_received_size_ - packets_received_.size();
   }
 
@@ -199,7 +206,7 @@ class Receiver {
   void IncExpCounter() { exp_count_ = exp_count_.load() + 1; }
 
   void ResetExpCounter() {
-    boost::mutex::scoped_lock lock_exp(mutex_);
+    SessionMutex::scoped_lock lock_exp(mutex_);
     exp_count_ = 1;
     last_exp_reset_timestamp_ = Clock::now();
   }
@@ -207,7 +214,7 @@ class Receiver {
   uint64_t exp_count() { return exp_count_.load(); }
 
   bool HasTimeout() {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     return exp_count_.load() > 16 &&
            boost::chrono::duration_cast<boost::chrono::seconds>(
                Clock::now() - last_exp_reset_timestamp_)
@@ -216,70 +223,70 @@ class Receiver {
 
   void PushReadOp(io::basic_pending_stream_read_operation<Protocol> *read_op) {
     {
-      boost::mutex::scoped_lock lock_read_ops(read_ops_mutex_);
+      SessionMutex::scoped_lock lock_read_ops(read_ops_mutex_);
       read_ops_queue_.push(read_op);
     }
-    p_session_->get_io_service().post(boost::bind(&Receiver::HandleQueues, this,
-                                                  boost::system::error_code()));
+    p_session_->get_protocol_io_service().post(boost::bind(
+        &Receiver::HandleQueues, this, boost::system::error_code()));
   }
 
   packet_sequence_number_type AckNumber(
       const SequenceGenerator &packet_seq_gen) {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     if (loss_list_.empty()) {
       return packet_seq_gen.Inc(lrsn_.load());
     } else {
-      return *(loss_list_.begin());
+      return loss_list_.Front();
     }
   }
 
   void set_largest_acknowledged_seq_number(
       packet_sequence_number_type largest_acknowledged_seq_number) {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     largest_acknowledged_seq_number_ = largest_acknowledged_seq_number;
   }
 
   packet_sequence_number_type largest_acknowledged_seq_number() {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     return largest_acknowledged_seq_number_;
   }
 
   void set_largest_ack_number_acknowledged(
       packet_sequence_number_type largest_ack_number_acknowledged) {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     largest_ack_number_acknowledged_ = largest_ack_number_acknowledged;
   }
 
   packet_sequence_number_type largest_ack_number_acknowledged() {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     return largest_ack_number_acknowledged_;
   }
 
   void set_last_ack2_seq_number(ack_sequence_number_type last_ack2_seq_number) {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     last_ack2_seq_number_ = last_ack2_seq_number;
     last_ack2_timestamp_ = Clock::now();
   }
 
   void set_last_ack_number(packet_sequence_number_type last_ack_number) {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     last_ack_number_ = last_ack_number;
   }
 
   packet_sequence_number_type last_ack_number() {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     return last_ack_number_;
   }
 
   TimePoint last_ack_timestamp() {
-    boost::mutex::scoped_lock lock(mutex_);
+    SessionMutex::scoped_lock lock(mutex_);
     return last_ack_timestamp_;
   }
 
  private:
   void HandleQueues(boost::system::error_code &ec) {
-    boost::mutex::scoped_lock packet_received_lock(packets_received_mutex_);
-    boost::mutex::scoped_lock read_ops_lock_(read_ops_mutex_);
+    SessionMutex::scoped_lock packet_received_lock(packets_received_mutex_);
+    SessionMutex::scoped_lock read_ops_lock_(read_ops_mutex_);
 
     if (read_ops_queue_.empty() || packets_received_.empty()) {
       return;
@@ -349,7 +356,7 @@ class Receiver {
   }
 
   void CloseReadOpsQueue() {
-    boost::mutex::scoped_lock lock_read_ops(read_ops_mutex_);
+    SessionMutex::scoped_lock lock_read_ops(read_ops_mutex_);
     // Unqueue read ops queue and callback with error code
     io::basic_pending_stream_read_operation<Protocol> *p_read_op;
     while (!read_ops_queue_.empty()) {
@@ -366,7 +373,7 @@ class Receiver {
 
  private:
   // mutex
-  boost::mutex mutex_;
+  SessionMutex mutex_;
   // session
   typename SocketSession::Ptr p_session_;
 
@@ -374,15 +381,15 @@ class Receiver {
   std::atomic<packet_sequence_number_type> lrsn_;
 
   // packets loss list, sorted by seq_number increased order
-  std::set<packet_sequence_number_type> loss_list_;
+  common::SequenceIntervalSet loss_list_;
 
   // Read ops queue
-  boost::mutex read_ops_mutex_;
+  SessionMutex read_ops_mutex_;
   ReadOpsQueue read_ops_queue_;
 
   // packets received
   uint32_t max_received_size_;
-  boost::mutex packets_received_mutex_;
+  SessionMutex packets_received_mutex_;
   ReceivedDatagramsMap packets_received_;
   packet_sequence_number_type last_buffer_seq_;
 
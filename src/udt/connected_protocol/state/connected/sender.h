@@ -3,19 +3,22 @@
 
 #include <cstdint>
 
-#include <map>
+#include <algorithm>
+#include <memory>
 #include <queue>
-#include <set>
-#include <unordered_set>
+#include <vector>
 
 #include <boost/asio/io_service.hpp>
-#include <boost/asio/buffers_iterator.hpp>
 
 #include <boost/chrono.hpp>
 #include <boost/log/trivial.hpp>
-#include <boost/thread/mutex.hpp>
 
 #include "udt/common/error/error.h"
+#include "udt/connected_protocol/common/sequence_interval_set.h"
+#include "udt/connected_protocol/common/sequence_ring.h"
+#include "udt/connected_protocol/common/session_mutex.h"
+#include "udt/connected_protocol/io/buffers.h"
+#include "udt/connected_protocol/io/free_list_pool.h"
 #include "udt/connected_protocol/io/write_op.h"
 #include "udt/queue/async_queue.h"
 
@@ -25,6 +28,15 @@ namespace connected {
 
 template <class Protocol, class ConnectedState>
 class Sender {
+ private:
+  /// Packets sent back to back at most to catch up a late schedule
+  enum { MAX_CATCH_UP_PERIODS = 16 };
+  /// Send datagrams preallocated per session, the pool then doubles up to
+  /// the packets in flight (queued and not acknowledged)
+  enum { SEND_POOL_SIZE = 64 };
+  /// Initial slots of the not acknowledged packets ring, doubled on demand
+  enum { NACK_RING_SIZE = 1024 };
+
  private:
   typedef typename queue::basic_async_queue<io::basic_pending_write_operation *>
       WriteOpsQueue;
@@ -39,77 +51,83 @@ class Sender {
 
  private:
   typedef typename Protocol::SendDatagram SendDatagram;
-  typedef std::unique_ptr<SendDatagram> SendDatagramPtr;
-  typedef typename Protocol::NAckDatagram NAckDatagram;
-  typedef std::shared_ptr<NAckDatagram> NAckDatagramPtr;
-  typedef std::unordered_set<PacketSequenceNumber> LossPacketsSet;
-  typedef std::map<PacketSequenceNumber, SendDatagramPtr> NackPacketsMap;
+  typedef common::SessionMutex SessionMutex;
+  typedef io::FreeListPool<SendDatagram> SendDatagramPool;
+
+  /// Give the send datagram back to its pool instead of freeing it
+  struct SendDatagramRelease {
+    explicit SendDatagramRelease(SendDatagramPool *pool = nullptr)
+        : p_pool(pool) {}
+
+    void operator()(SendDatagram *p_datagram) const {
+      p_pool->Release(p_datagram);
+    }
+
+    SendDatagramPool *p_pool;
+  };
+
+  typedef std::unique_ptr<SendDatagram, SendDatagramRelease> SendDatagramPtr;
+  typedef typename Protocol::NAckView NAckView;
+  typedef common::SequenceIntervalSet LossPacketsSet;
+  typedef common::SequenceRing<SendDatagramPtr> NackPacketsRing;
 
  public:
   Sender(boost::asio::io_service &io_service,
          typename SocketSession::Ptr p_session)
       : p_session_(p_session),
         p_state_(nullptr),
+        p_weak_state_(),
         max_send_size_(8192),
-        write_ops_mutex_(),
+        write_ops_mutex_(p_session_->serialized()),
         write_ops_queue_(io_service),
         unqueue_write_op_(false),
-        loss_packets_mutex_(),
-        loss_packets_(),
-        nack_packets_mutex_(),
-        nack_packets_(),
+        send_datagram_pool_(SEND_POOL_SIZE),
+        loss_packets_mutex_(p_session_->serialized()),
+        loss_packets_(p_session_->packet_seq_gen),
+        nack_packets_mutex_(p_session_->serialized()),
+        nack_packets_(Protocol::MAX_PACKET_SEQUENCE_NUMBER, NACK_RING_SIZE),
         last_ack_number_(0),
-        sending_time_mutex_(),
-        next_sending_packet_time_(0),
-        packets_to_send_mutex_(),
-        packets_to_send_() {}
+        sending_time_mutex_(p_session_->serialized()),
+        next_sending_packet_time_(),
+        packets_to_send_mutex_(p_session_->serialized()),
+        packets_to_send_(),
+        new_packets_() {}
 
   void Init(typename ConnectedState::Ptr p_state,
             CongestionControl *p_congestion_control) {
     p_congestion_control_ = p_congestion_control;
-    p_state_ = p_state;
+    p_weak_state_ = p_state;
+    p_state_ = std::move(p_state);
     StartUnqueueWriteOp();
   }
 
   void Stop() {
     StopUnqueueWriteOp();
     CloseWriteOpsQueue();
+    CancelQueuedWriteOps();
     p_state_.reset();
   }
 
+  /// @return number of packets built while the send pool had no free
+  /// datagram
+  uint32_t send_pool_exhausted_count() const {
+    return send_datagram_pool_.exhausted_count();
+  }
+
+  void reset_send_pool_exhausted_count() {
+    send_datagram_pool_.reset_exhausted_count();
+  }
+
   bool HasNackPackets() {
-    boost::mutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
+    SessionMutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
     return !nack_packets_.empty();
   }
 
-  void UpdateLossListFromNackDgr(const NAckDatagram &nack_dgr) {
-    auto nack_loss_list = nack_dgr.payload().GetLossPackets();
-    std::size_t loss_list_size = nack_loss_list.size();
-
+  void UpdateLossListFromNackDgr(const NAckView &nack_dgr) {
     {
-      boost::mutex::scoped_lock lock_loss_packets(loss_packets_mutex_);
-
-      for (uint32_t i = 0; i < loss_list_size; ++i) {
-        PacketSequenceNumber current_seq = nack_loss_list[i];
-        // first interval seq
-        if (IsInterval(current_seq)) {
-          PacketSequenceNumber first_range =
-              GetPacketSequenceValue(current_seq);
-          ++i;
-          if (i < loss_list_size && !IsInterval(nack_loss_list[i])) {
-            auto &packet_seq_gen = p_session_->packet_seq_gen;
-            PacketSequenceNumber second_range =
-                GetPacketSequenceValue(nack_loss_list[i]);
-            PacketSequenceNumber j = first_range;
-            while (j != second_range) {
-              loss_packets_.insert(j);
-              j = packet_seq_gen.Inc(j);
-            }
-          }
-        } else {
-          loss_packets_.insert(GetPacketSequenceValue(current_seq));
-        }
-      }
+      SessionMutex::scoped_lock lock_loss_packets(loss_packets_mutex_);
+
+      nack_dgr.payload().InsertInto(&loss_packets_);
 
       if (loss_packets_.empty()) {
         return;
@@ -121,28 +139,28 @@ class Sender {
 
   void UpdateLossListFromNackPackets() {
     {
-      boost::mutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
-      boost::mutex::scoped_lock lock_loss_packets(loss_packets_mutex_);
+      SessionMutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
+      SessionMutex::scoped_lock lock_loss_packets(loss_packets_mutex_);
 
       if (nack_packets_.empty()) {
         return;
       }
 
-      auto nack_packet_it = nack_packets_.begin();
-      auto nack_packet_end_it = nack_packets_.end();
-
-      while (nack_packet_it != nack_packet_end_it) {
-        const auto &seq_num = nack_packet_it->first;
-        if (!nack_packet_it->second->is_acked()) {
-          loss_packets_.insert(seq_num);
-          ++nack_packet_it;
-        } else {
-          if (!nack_packet_it->second->is_pending_send()) {
-            nack_packet_it = nack_packets_.erase(nack_packet_it);
-          } else {
-            ++nack_packet_it;
+      // Erasing moves the window start, not the following sequences
+      PacketSequenceNumber seq_num = nack_packets_.first_sequence();
+      std::size_t span = nack_packets_.span();
+      for (std::size_t i = 0; i < span; ++i) {
+        SendDatagramPtr *p_nack_packet = nack_packets_.Find(seq_num);
+        if (p_nack_packet) {
+          SendDatagram *p_datagram = p_nack_packet->get();
+          if (!p_datagram->is_acked()) {
+            loss_packets_.Insert(seq_num);
+          } else if (!p_datagram->is_pending_send()) {
+            p_datagram->payload().complete(p_session_->get_io_service());
+            nack_packets_.Erase(seq_num);
           }
         }
+        seq_num = nack_packets_.Inc(seq_num);
       }
     }
 
@@ -150,50 +168,53 @@ class Sender {
   }
 
   bool HasLossPackets() {
-    boost::mutex::scoped_lock lock(loss_packets_mutex_);
+    SessionMutex::scoped_lock lock(loss_packets_mutex_);
     return !loss_packets_.empty();
   }
 
   bool HasPacketToSend() {
-    boost::mutex::scoped_lock lock_packets_to_send(packets_to_send_mutex_);
-    boost::mutex::scoped_lock lock(loss_packets_mutex_);
+    SessionMutex::scoped_lock lock_packets_to_send(packets_to_send_mutex_);
+    SessionMutex::scoped_lock lock(loss_packets_mutex_);
     return !packets_to_send_.empty() || !loss_packets_.empty();
   }
 
-  boost::chrono::nanoseconds NextScheduledPacketTime() {
-    boost::mutex::scoped_lock lock_sending_time(sending_time_mutex_);
+  /// @return time the next packet is due, in the past when late
+  TimePoint NextScheduledPacketTime() {
+    SessionMutex::scoped_lock lock_sending_time(sending_time_mutex_);
     return next_sending_packet_time_;
   }
 
   SendDatagram *NextScheduledPacket() {
-    TimePoint start_gen(Clock::now());
-
     SendDatagram *p_datagram(nullptr);
 
     PacketSequenceNumber seq_num = p_session_->packet_seq_gen.current();
 
     {
-      boost::mutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
-      boost::mutex::scoped_lock lock_loss_packets(loss_packets_mutex_);
+      SessionMutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
+      SessionMutex::scoped_lock lock_loss_packets(loss_packets_mutex_);
 
       // Loss packet first
       if (!loss_packets_.empty()) {
         boost::system::error_code push_ec;
-        PacketSequenceNumber packet_loss_number = *(loss_packets_.begin());
-        loss_packets_.erase(packet_loss_number);
+        PacketSequenceNumber packet_loss_number = loss_packets_.PopFront();
 
         // nack_packets can be updated and the loss packet is not lost anymore
         // so
         // check if it's in
-        if (nack_packets_.find(packet_loss_number) != nack_packets_.end()) {
-          p_datagram = nack_packets_[packet_loss_number].get();
-          if (!p_datagram->is_acked()) {
-            UpdateNextSendingPacketTime(p_datagram, start_gen);
+        SendDatagramPtr *p_nack_packet =
+            nack_packets_.Find(packet_loss_number);
+        if (p_nack_packet) {
+          p_datagram = p_nack_packet->get();
+          if (p_datagram->is_pending_send()) {
+            // Still on its way to the socket, which resends it already
+          } else if (!p_datagram->is_acked()) {
+            // Held until its send ended, see OnPacketSent
+            p_datagram->set_pending_send(true);
+            UpdateNextSendingPacketTime(p_datagram);
             return p_datagram;
           } else {
-            if (!p_datagram->is_pending_send()) {
-              nack_packets_.erase(packet_loss_number);
-            }
+            p_datagram->payload().complete(p_session_->get_io_service());
+            nack_packets_.Erase(packet_loss_number);
           }
         }
       }
@@ -201,8 +222,8 @@ class Sender {
 
     SendDatagramPtr p_unique_datagram_ptr;
     {
-      boost::mutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
-      boost::mutex::scoped_lock lock_packets_to_send(packets_to_send_mutex_);
+      SessionMutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
+      SessionMutex::scoped_lock lock_packets_to_send(packets_to_send_mutex_);
       if (!packets_to_send_.empty()) {
         // Too many datagram not acked, wait an ack to continue to send =>
         // congestion policy update value
@@ -211,6 +232,7 @@ class Sender {
             nack_packets_.size() >=
                 std::min(p_congestion_control_->window_flow_size(),
                          p_session_->get_window_flow_size())) {
+          PostponeNextSendingPacketTime();
           return nullptr;
         }
 
@@ -232,15 +254,17 @@ class Sender {
       return nullptr;
     }
 
-    UpdateNextSendingPacketTime(p_unique_datagram_ptr.get(), start_gen);
+    p_datagram = p_unique_datagram_ptr.get();
+    UpdateNextSendingPacketTime(p_datagram);
 
-    // Save packet as not acked
+    // Save packet as not acked, held until its send ended
     {
-      boost::mutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
-      nack_packets_[seq_num] = std::move(p_unique_datagram_ptr);
+      SessionMutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
+      p_datagram->set_pending_send(true);
+      nack_packets_.Insert(seq_num, std::move(p_unique_datagram_ptr));
     }
 
-    return nack_packets_[seq_num].get();
+    return p_datagram;
   }
 
   void AckPackets(PacketSequenceNumber seq_number) {
@@ -249,17 +273,27 @@ class Sender {
     auto &packet_seq_gen = p_session_->packet_seq_gen;
 
     {
-      boost::mutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
-      boost::mutex::scoped_lock lock_loss_packets(loss_packets_mutex_);
-      // remove packest whose seq_number < seq_number from sent_packets
-      PacketSequenceNumber current_seq_num = packet_seq_gen.Dec(seq_number);
-      auto p_nack_packet_it = nack_packets_.find(current_seq_num);
-      auto p_nack_packet_end_it = nack_packets_.end();
-      while (p_nack_packet_it != p_nack_packet_end_it) {
-        loss_packets_.erase(current_seq_num);
-        current_seq_num = packet_seq_gen.Dec(current_seq_num);
-        p_nack_packet_it->second->set_acked(true);
-        p_nack_packet_it = nack_packets_.find(current_seq_num);
+      SessionMutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
+      SessionMutex::scoped_lock lock_loss_packets(loss_packets_mutex_);
+      loss_packets_.EraseBefore(seq_number);
+
+      // ack packets whose seq_number < seq_number from the window start
+      PacketSequenceNumber current_seq_num = nack_packets_.first_sequence();
+      std::size_t span = nack_packets_.span();
+      for (std::size_t i = 0;
+           i < span && packet_seq_gen.Compare(current_seq_num, seq_number) < 0;
+           ++i) {
+        SendDatagramPtr *p_nack_packet = nack_packets_.Find(current_seq_num);
+        if (p_nack_packet) {
+          SendDatagram *p_datagram = p_nack_packet->get();
+          p_datagram->set_acked(true);
+          if (!p_datagram->is_pending_send()) {
+            // Otherwise completed and erased once sent
+            p_datagram->payload().complete(p_session_->get_io_service());
+            nack_packets_.Erase(current_seq_num);
+          }
+        }
+        current_seq_num = nack_packets_.Inc(current_seq_num);
       }
     }
   }
@@ -274,28 +308,36 @@ class Sender {
   }
 
  private:
-  void UpdateNextSendingPacketTime(SendDatagram *p_datagram,
-                                   const TimePoint &start_gen) {
-    boost::chrono::nanoseconds gen_time =
-        boost::chrono::duration_cast<boost::chrono::nanoseconds>(Clock::now() -
-                                                                 start_gen);
+  /// Schedule the next packet one sending period after the one just sent
+  /**
+  * Deadlines are absolute : a packet sent late does not delay the following
+  * ones, which are then due immediately (catch-up burst). The burst is
+  * bounded to MAX_CATCH_UP_PERIODS packets.
+  */
+  void UpdateNextSendingPacketTime(SendDatagram *p_datagram) {
+    SessionMutex::scoped_lock lock_sending_time(sending_time_mutex_);
     if (p_datagram->header().packet_sequence_number() % 16 == 0 ||
         !loss_packets_.empty()) {
       // every 16n packet, send a new one immediatly to evaluate link capacity
       // resend immediatly if there is loss packets
-      next_sending_packet_time_ = boost::chrono::nanoseconds(0);
-    } else {
-      boost::chrono::nanoseconds next_interval =
-          boost::chrono::duration_cast<boost::chrono::nanoseconds>(
-              p_congestion_control_->sending_period() - gen_time);
-      if (next_interval.count() > 0) {
-        boost::mutex::scoped_lock lock_sending_time(sending_time_mutex_);
-        next_sending_packet_time_ = next_interval;
-      } else {
-        boost::mutex::scoped_lock lock_sending_time(sending_time_mutex_);
-        next_sending_packet_time_ = boost::chrono::nanoseconds(0);
-      }
+      // (deadline left in the past)
+      return;
     }
+
+    boost::chrono::nanoseconds sending_period(
+        p_congestion_control_->sending_period());
+    TimePoint earliest_time(Clock::now() -
+                            sending_period * MAX_CATCH_UP_PERIODS);
+    next_sending_packet_time_ =
+        std::max(next_sending_packet_time_, earliest_time) + sending_period;
+  }
+
+  /// Nothing could be sent : retry one sending period from now rather than
+  /// on the past deadline
+  void PostponeNextSendingPacketTime() {
+    SessionMutex::scoped_lock lock_sending_time(sending_time_mutex_);
+    next_sending_packet_time_ =
+        Clock::now() + p_congestion_control_->sending_period();
   }
 
   void CloseWriteOpsQueue() {
@@ -318,12 +360,9 @@ class Sender {
   }
 
   void AckPacket(const typename SendDatagram::Header &packet_header) {
-    boost::mutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
-    auto packet_pair_it = nack_packets_.find(
+    SessionMutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
+    nack_packets_.Erase(
         GetPacketSequenceValue(packet_header.packet_sequence_number()));
-    if (packet_pair_it != nack_packets_.end()) {
-      nack_packets_.erase(packet_pair_it);
-    }
   }
 
   void StartUnqueueWriteOp() {
@@ -349,118 +388,255 @@ class Sender {
       return;
     }
 
-    std::size_t total_copy(ProcessWriteOpBuffers(p_write_op->const_buffers()));
+    if (p_session_->send_copy.load()) {
+      std::size_t total_copy(
+          ProcessWriteOpBuffers(p_write_op->const_buffers()));
 
-    // Execute handler
-    auto do_complete = [p_write_op, total_copy]() {
-      p_write_op->complete(
-          boost::system::error_code(::common::error::success,
-                                    ::common::error::get_error_category()),
-          total_copy);
-    };
-    p_session_->get_io_service().post(do_complete);
+      // Execute handler
+      auto do_complete = [p_write_op, total_copy]() {
+        p_write_op->complete(
+            boost::system::error_code(::common::error::success,
+                                      ::common::error::get_error_category()),
+            total_copy);
+      };
+      p_session_->get_io_service().post(do_complete);
+    } else {
+      ReferenceWriteOpBuffers(p_write_op);
+    }
 
     p_session_->p_flow->RegisterNewSocket(p_session_);
 
     UnqueueWriteOp();
   }
 
-  /// @return size of processed data
+  /// Queue packets holding a copy of the write buffers
+  /**
+  * Like the zero copy path, packets are built before being queued so that
+  * the flow never sends a packet being filled.
+  *
+  * @return size of processed data
+  */
   std::size_t ProcessWriteOpBuffers(
       const io::fixed_const_buffer_sequence &write_buffers) {
-    std::size_t copy_length(0);
-    std::size_t packet_created(0);
-    std::size_t total_copy(0);
-    bool add_error(false);
     uint32_t message_seq_number = p_session_->message_seq_gen.Next();
-
-    auto user_buf_current_it = boost::asio::buffers_begin(write_buffers);
-
-    auto user_buf_end_it = boost::asio::buffers_end(write_buffers);
+    std::size_t packet_data_size(
+        p_session_->connection_info.packet_data_size() -
+        SendDatagram::Header::size);
+    std::size_t available_packets(AvailablePacketsToSend());
+    io::BufferSequenceReader<io::fixed_const_buffer_sequence> user_buf_reader(
+        write_buffers);
+
+    auto &packets = new_packets_;
+    packets.clear();
+    std::size_t total_copy(0);
 
     // generate datagrams
-    SendDatagram *p_current_datagram(nullptr), *p_previous_datagram(nullptr);
-    while ((user_buf_current_it != user_buf_end_it) && !add_error) {
-      SendDatagramPtr p_unique_current_datagram =
-          std::unique_ptr<SendDatagram>(new SendDatagram());
-      copy_length = 0;
-      p_current_datagram = p_unique_current_datagram.get();
-      auto &header = p_current_datagram->header();
-      auto &payload = p_current_datagram->payload();
-      payload.SetSize(p_session_->connection_info.packet_data_size() -
-                      SendDatagram::Header::size);
-      auto payload_buf = payload.GetMutableBuffers();
-      auto current_payload_it = boost::asio::buffers_begin(payload_buf);
-      auto end_payload_it = boost::asio::buffers_end(payload_buf);
-
-      // Copy user buffer in payload buf
-      while ((user_buf_current_it != user_buf_end_it) &&
-             (current_payload_it != end_payload_it)) {
-        *current_payload_it = *user_buf_current_it;
-
-        ++copy_length;
-        ++current_payload_it;
-        ++user_buf_current_it;
-      }
-      payload.SetSize(copy_length);
+    while (!user_buf_reader.empty() && packets.size() < available_packets) {
+      SendDatagramPtr p_datagram(NewDatagram());
+
+      // Copy user buffer in payload buf, memcpy chunk by chunk
+      total_copy +=
+          p_datagram->payload().CopyFrom(&user_buf_reader, packet_data_size);
       // complete packet header
+      auto &header = p_datagram->header();
       header.set_message_number(message_seq_number);
       header.set_destination_socket(p_session_->remote_socket_id);
+      header.set_message_position(packets.empty()
+                                      ? SendDatagram::Header::FIRST
+                                      : SendDatagram::Header::MIDDLE);
+      packets.push_back(std::move(p_datagram));
+    }
 
-      add_error = !(AddPacket(std::move(p_unique_current_datagram)));
+    if (packets.empty()) {
+      return 0;
+    }
 
-      if ((add_error && packet_created == 0)) {
-        return 0;
-      }
+    packets.back()->header().set_message_position(
+        packets.size() == 1 ? SendDatagram::Header::ONLY_ONE_PACKET
+                            : SendDatagram::Header::LAST);
+    QueueNewPackets();
 
-      if (add_error) {
-        if (packet_created == 1) {
-          p_previous_datagram->header().set_message_position(
-              SendDatagram::Header::ONLY_ONE_PACKET);
-        } else {
-          p_previous_datagram->header().set_message_position(
-              SendDatagram::Header::LAST);
+    return total_copy;
+  }
+
+  /// Queue packets referencing the write op buffers (zero copy)
+  /**
+  * The write op is carried by the last queued packet and completes once it
+  * is acknowledged : the buffers are not read anymore. Packets are built
+  * before being queued so that the flow never sends a packet being filled.
+  */
+  void ReferenceWriteOpBuffers(io::basic_pending_write_operation *p_write_op) {
+    io::fixed_const_buffer_sequence write_buffers(p_write_op->const_buffers());
+    uint32_t message_seq_number = p_session_->message_seq_gen.Next();
+    std::size_t packet_data_size(
+        p_session_->connection_info.packet_data_size() -
+        SendDatagram::Header::size);
+    std::size_t available_packets(AvailablePacketsToSend());
+
+    auto &packets = new_packets_;
+    packets.clear();
+    std::size_t total_size(0);
+    auto buffer_it = write_buffers.begin();
+    auto buffer_end_it = write_buffers.end();
+    std::size_t buffer_offset(0);
+
+    while (buffer_it != buffer_end_it && packets.size() < available_packets) {
+      SendDatagramPtr p_datagram(NewDatagram());
+      auto &payload = p_datagram->payload();
+      std::size_t packet_size(0);
+
+      while (buffer_it != buffer_end_it && packet_size < packet_data_size) {
+        std::size_t buffer_size(boost::asio::buffer_size(*buffer_it));
+        std::size_t length(std::min(buffer_size - buffer_offset,
+                                    packet_data_size - packet_size));
+        if (length > 0 &&
+            !payload.AddConstBuffer(
+                boost::asio::buffer(*buffer_it + buffer_offset, length))) {
+          // No more buffer slot in the packet
+          break;
         }
-      } else {
-        total_copy += copy_length;
-        if (user_buf_current_it != user_buf_end_it) {
-          // no more data to copy
-          if (packet_created == 1) {
-            header.set_message_position(SendDatagram::Header::ONLY_ONE_PACKET);
-          } else {
-            header.set_message_position(SendDatagram::Header::LAST);
-          }
-        } else {
-          header.set_message_position(SendDatagram::Header::MIDDLE);
+        packet_size += length;
+        buffer_offset += length;
+        if (buffer_offset == buffer_size) {
+          ++buffer_it;
+          buffer_offset = 0;
         }
       }
 
-      packet_created++;
-      p_previous_datagram = p_current_datagram;
+      if (packet_size == 0) {
+        // Only empty buffers left
+        break;
+      }
+
+      auto &header = p_datagram->header();
+      header.set_message_number(message_seq_number);
+      header.set_destination_socket(p_session_->remote_socket_id);
+      header.set_message_position(packets.empty()
+                                      ? SendDatagram::Header::FIRST
+                                      : SendDatagram::Header::MIDDLE);
+      total_size += packet_size;
+      packets.push_back(std::move(p_datagram));
     }
 
-    return total_copy;
+    if (packets.empty()) {
+      auto do_complete = [p_write_op]() {
+        p_write_op->complete(
+            boost::system::error_code(::common::error::success,
+                                      ::common::error::get_error_category()),
+            0);
+      };
+      p_session_->get_io_service().post(do_complete);
+      return;
+    }
+
+    auto &last_datagram = *packets.back();
+    last_datagram.header().set_message_position(
+        packets.size() == 1 ? SendDatagram::Header::ONLY_ONE_PACKET
+                            : SendDatagram::Header::LAST);
+    last_datagram.payload().set_p_sized_op(p_write_op);
+    last_datagram.payload().set_total_copy(total_size);
+
+    QueueNewPackets();
   }
 
-  boost::asio::const_buffer SubBuffer(const boost::asio::const_buffer &buffer,
-                                      std::size_t end_offset) {
-    const uint8_t *buffer_data =
-        boost::asio::buffer_cast<const uint8_t *>(buffer);
-    return boost::asio::buffer(buffer_data, end_offset);
+  /// Queue the built packets of the current write in one lock
+  void QueueNewPackets() {
+    SessionMutex::scoped_lock lock_packets_to_send(packets_to_send_mutex_);
+    for (auto &p_datagram : new_packets_) {
+      packets_to_send_.push(std::move(p_datagram));
+    }
+    new_packets_.clear();
+  }
+
+  /// Send datagram from the session pool, reset for a new packet
+  SendDatagramPtr NewDatagram() {
+    SendDatagram *p_datagram = send_datagram_pool_.Acquire();
+    p_datagram->header() = typename SendDatagram::Header();
+    p_datagram->payload().Reset();
+    p_datagram->set_pending_send(false);
+    p_datagram->set_acked(false);
+    p_datagram->set_sent_callback(&Sender::OnPacketSent, this);
+    return SendDatagramPtr(p_datagram,
+                           SendDatagramRelease(&send_datagram_pool_));
   }
 
-  bool AddPacket(SendDatagramPtr p_unique_datagram) {
-    boost::mutex::scoped_lock lock_packets_to_send(packets_to_send_mutex_);
-    if (packets_to_send_.size() > max_send_size_) {
-      return false;
+  /// Send of a handed out packet ended : release it if acked meanwhile
+  /**
+  * Acks skip the packets pending send, which are completed and erased here.
+  * Serialized sessions process it on their thread : the posted handler
+  * holds the state, hence the sender and its datagram pool.
+  */
+  static void OnPacketSent(void *p_context, SendDatagram *p_datagram) {
+    Sender *p_sender = static_cast<Sender *>(p_context);
+    if (p_sender->p_session_->serialized()) {
+      typename ConnectedState::Ptr p_state(p_sender->p_weak_state_.lock());
+      if (!p_state) {
+        // Sender being destroyed with its packets
+        return;
+      }
+      p_sender->p_session_->get_protocol_io_service().post(
+          [p_state, p_sender, p_datagram]() {
+            p_sender->ReleaseSentPacket(p_datagram);
+          });
+      return;
     }
 
-    packets_to_send_.push(std::move(p_unique_datagram));
-    return true;
+    p_sender->ReleaseSentPacket(p_datagram);
   }
 
-  bool IsInterval(PacketSequenceNumber seq_num) const {
-    return 0 != (seq_num & 0x80000000);
+  void ReleaseSentPacket(SendDatagram *p_datagram) {
+    SessionMutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
+    p_datagram->set_pending_send(false);
+    if (!p_datagram->is_acked()) {
+      return;
+    }
+
+    p_datagram->payload().complete(p_session_->get_io_service());
+    PacketSequenceNumber seq_num(
+        GetPacketSequenceValue(p_datagram->header().packet_sequence_number()));
+    SendDatagramPtr *p_nack_packet = nack_packets_.Find(seq_num);
+    if (p_nack_packet && p_nack_packet->get() == p_datagram) {
+      nack_packets_.Erase(seq_num);
+    }
+  }
+
+  std::size_t AvailablePacketsToSend() {
+    SessionMutex::scoped_lock lock_packets_to_send(packets_to_send_mutex_);
+    return packets_to_send_.size() > max_send_size_
+               ? 0
+               : max_send_size_ + 1 - packets_to_send_.size();
+  }
+
+  /// Complete the zero copy writes not acknowledged yet with an error
+  void CancelQueuedWriteOps() {
+    boost::system::error_code ec(::common::error::operation_canceled,
+                                 ::common::error::get_error_category());
+    {
+      SessionMutex::scoped_lock lock_packets_to_send(packets_to_send_mutex_);
+      while (!packets_to_send_.empty()) {
+        packets_to_send_.front()->payload().complete(
+            p_session_->get_io_service(), ec);
+        packets_to_send_.pop();
+      }
+    }
+
+    SessionMutex::scoped_lock lock_nack_packets(nack_packets_mutex_);
+    PacketSequenceNumber seq_num = nack_packets_.first_sequence();
+    std::size_t span = nack_packets_.span();
+    for (std::size_t i = 0; i < span; ++i) {
+      SendDatagramPtr *p_nack_packet = nack_packets_.Find(seq_num);
+      if (p_nack_packet) {
+        (*p_nack_packet)->payload().complete(p_session_->get_io_service(), ec);
+      }
+      seq_num = nack_packets_.Inc(seq_num);
+    }
+  }
+
+  boost::asio::const_buffer SubBuffer(const boost::asio::const_buffer &buffer,
+                                      std::size_t end_offset) {
+    const uint8_t *buffer_data =
+        boost::asio::buffer_cast<const uint8_t *>(buffer);
+    return boost::asio::buffer(buffer_data, end_offset);
   }
 
   PacketSequenceNumber GetPacketSequenceValue(
@@ -471,26 +647,33 @@ class Sender {
  private:
   typename SocketSession::Ptr p_session_;
   typename ConnectedState::Ptr p_state_;
+  // set once by Init, kept after Stop for the packets still in flight
+  std::weak_ptr<ConnectedState> p_weak_state_;
   uint32_t max_send_size_;
-  boost::mutex write_ops_mutex_;
+  SessionMutex write_ops_mutex_;
   WriteOpsQueue write_ops_queue_;
   bool unqueue_write_op_;
 
-  // packets loss set, sorted by seq_number increased order
-  boost::mutex loss_packets_mutex_;
-  std::set<PacketSequenceNumber> loss_packets_;
+  // send datagrams storage, declared first to outlive the packets
+  SendDatagramPool send_datagram_pool_;
+
+  // packets loss intervals, sorted by seq_number increased order
+  SessionMutex loss_packets_mutex_;
+  LossPacketsSet loss_packets_;
 
   // packets not ack
-  boost::mutex nack_packets_mutex_;
-  NackPacketsMap nack_packets_;
+  SessionMutex nack_packets_mutex_;
+  NackPacketsRing nack_packets_;
   std::atomic<PacketSequenceNumber> last_ack_number_;
 
   // timepoint of the next sending packet
-  boost::mutex sending_time_mutex_;
-  boost::chrono::nanoseconds next_sending_packet_time_;
+  SessionMutex sending_time_mutex_;
+  TimePoint next_sending_packet_time_;
 
-  boost::mutex packets_to_send_mutex_;
+  SessionMutex packets_to_send_mutex_;
   std::queue<SendDatagramPtr> packets_to_send_;
+  // packets of the write being processed, reused between writes
+  std::vector<SendDatagramPtr> new_packets_;
 
   CongestionControl *p_congestion_control_;
 };
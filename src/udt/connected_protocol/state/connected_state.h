@@ -42,14 +42,18 @@ class ConnectedState : public BaseState<Protocol>,
   typedef std::shared_ptr<SendDatagram> SendDatagramPtr;
   typedef typename Protocol::DataDatagram DataDatagram;
   typedef std::shared_ptr<DataDatagram> DataDatagramPtr;
+  typedef typename Protocol::DataView DataView;
   typedef typename Protocol::ConnectionDatagram ConnectionDatagram;
   typedef std::shared_ptr<ConnectionDatagram> ConnectionDatagramPtr;
   typedef typename Protocol::GenericControlDatagram ControlDatagram;
   typedef std::shared_ptr<ControlDatagram> ControlDatagramPtr;
+  typedef typename Protocol::ControlHeader ControlHeader;
+  typedef typename Protocol::ControlView ControlView;
+  typedef typename Protocol::AckView AckView;
+  typedef typename Protocol::NAckView NAckView;
+  typedef typename Protocol::AckOfAckView AckOfAckView;
   typedef typename Protocol::AckDatagram AckDatagram;
   typedef std::shared_ptr<AckDatagram> AckDatagramPtr;
-  typedef typename Protocol::NAckDatagram NAckDatagram;
-  typedef std::shared_ptr<NAckDatagram> NAckDatagramPtr;
   typedef typename Protocol::AckOfAckDatagram AckOfAckDatagram;
   typedef std::shared_ptr<AckOfAckDatagram> AckOfAckDatagramPtr;
   typedef typename Protocol::KeepAliveDatagram KeepAliveDatagram;
@@ -86,6 +90,12 @@ class ConnectedState : public BaseState<Protocol>,
     sender_.Init(this->shared_from_this(), &congestion_control_);
     congestion_control_.Init(p_session_->init_packet_seq_num,
                              p_session_->max_window_flow_size);
+    auto p_shared_congestion_state =
+        p_session_->p_flow->shared_congestion_state();
+    if (p_shared_congestion_state) {
+      congestion_control_.Share(std::move(p_shared_congestion_state),
+                                p_session_->send_weight);
+    }
 
     ack_timer_.expires_from_now(p_session_->connection_info.ack_period());
     ack_timer_.async_wait(boost::bind(&ConnectedState::AckTimerHandler,
@@ -111,15 +121,15 @@ class ConnectedState : public BaseState<Protocol>,
     p_session_->ChangeState(ClosedState::Create(p_session_->get_io_service()));
   }
 
-  virtual void OnDataDgr(DataDatagram* p_datagram) {
+  virtual void OnDataDgr(const DataView& data_view) {
     ResetExp(false);
 
     if (Logger::ACTIVE) {
       received_count_ = received_count_.load() + 1;
     }
 
-    congestion_control_.OnPacketReceived(*p_datagram);
-    receiver_.OnDataDatagram(p_datagram);
+    congestion_control_.OnPacketReceived(data_view);
+    receiver_.OnDataDatagram(data_view);
 
     packet_received_since_light_ack_ =
         packet_received_since_light_ack_.load() + 1;
@@ -139,7 +149,7 @@ class ConnectedState : public BaseState<Protocol>,
 
   virtual bool HasPacketToSend() { return sender_.HasPacketToSend(); }
 
-  virtual boost::chrono::nanoseconds NextScheduledPacketTime() {
+  virtual TimePoint NextScheduledPacketTime() {
     return sender_.NextScheduledPacketTime();
   }
 
@@ -157,42 +167,28 @@ class ConnectedState : public BaseState<Protocol>,
     this->ProcessConnectionDgr(p_session_, std::move(p_connection_dgr));
   }
 
-  virtual void OnControlDgr(ControlDatagram* p_control_dgr) {
-    switch (p_control_dgr->header().flags()) {
-      case ControlDatagram::Header::KEEP_ALIVE:
+  virtual void OnControlDgr(const ControlView& control_view) {
+    switch (control_view.header().flags()) {
+      case ControlHeader::KEEP_ALIVE:
         ResetExp(false);
         break;
-      case ControlDatagram::Header::ACK: {
+      case ControlHeader::ACK:
         ResetExp(true);
-        AckDatagram ack_dgr;
-        boost::asio::buffer_copy(ack_dgr.GetMutableBuffers(),
-                                 p_control_dgr->GetConstBuffers());
-        ack_dgr.payload().set_payload_size(p_control_dgr->payload().GetSize());
-        OnAck(ack_dgr);
+        OnAck(AckView(control_view));
         break;
-      }
-      case ControlDatagram::Header::NACK: {
+      case ControlHeader::NACK:
         ResetExp(true);
-        NAckDatagram nack_dgr;
-        nack_dgr.payload().SetSize(p_control_dgr->payload().GetSize());
-        boost::asio::buffer_copy(nack_dgr.GetMutableBuffers(),
-                                 p_control_dgr->GetConstBuffers());
-        OnNAck(nack_dgr);
+        OnNAck(NAckView(control_view));
         break;
-      }
-      case ControlDatagram::Header::SHUTDOWN:
+      case ControlHeader::SHUTDOWN:
         ResetExp(false);
         Close();
         break;
-      case ControlDatagram::Header::ACK_OF_ACK: {
+      case ControlHeader::ACK_OF_ACK:
         ResetExp(false);
-        AckOfAckDatagram ack_of_ack_dgr;
-        boost::asio::buffer_copy(ack_of_ack_dgr.GetMutableBuffers(),
-                                 p_control_dgr->GetConstBuffers());
-        OnAckOfAck(ack_of_ack_dgr);
+        OnAckOfAck(control_view);
         break;
-      }
-      case ControlDatagram::Header::MESSAGE_DROP_REQUEST:
+      case ControlHeader::MESSAGE_DROP_REQUEST:
         ResetExp(false);
         break;
     }
@@ -201,8 +197,8 @@ class ConnectedState : public BaseState<Protocol>,
  private:
   ConnectedState(typename SocketSession::Ptr p_session)
       : p_session_(std::move(p_session)),
-        sender_(p_session_->get_io_service(), p_session_),
-        receiver_(p_session_->get_io_service(), p_session_),
+        sender_(p_session_->get_protocol_io_service(), p_session_),
+        receiver_(p_session_->get_protocol_io_service(), p_session_),
         unqueue_write_op_(false),
         congestion_control_(&(p_session_->connection_info)),
         stop_timers_(false),
@@ -319,6 +315,7 @@ class ConnectedState : public BaseState<Protocol>,
     p_log->local_estimated_link_capacity = receiver_.GetEstimatedLinkCapacity();
     p_log->ack_sent_count = ack_sent_count_.load();
     p_log->ack2_sent_count = ack2_sent_count_.load();
+    p_log->send_pool_exhausted_count = sender_.send_pool_exhausted_count();
   }
 
   void ResetLog() {
@@ -328,6 +325,7 @@ class ConnectedState : public BaseState<Protocol>,
     received_count_ = 0;
     ack_sent_count_ = 0;
     ack2_sent_count_ = 0;
+    sender_.reset_send_pool_exhausted_count();
   }
 
   virtual double PacketArrivalSpeed() {
@@ -413,7 +411,7 @@ class ConnectedState : public BaseState<Protocol>,
 
   // Packet processing
  private:
-  void OnAck(const AckDatagram& ack_dgr) {
+  void OnAck(const AckView& ack_dgr) {
     auto self = this->shared_from_this();
     auto& packet_seq_gen = p_session_->packet_seq_gen;
     auto& header = ack_dgr.header();
@@ -479,7 +477,7 @@ class ConnectedState : public BaseState<Protocol>,
     }
   }
 
-  void OnNAck(const NAckDatagram& nack_dgr) {
+  void OnNAck(const NAckView& nack_dgr) {
     if (Logger::ACTIVE) {
       nack_count_ = nack_count_.load() + 1;
     }
@@ -488,7 +486,7 @@ class ConnectedState : public BaseState<Protocol>,
     congestion_control_.OnLoss(nack_dgr, p_session_->packet_seq_gen);
   }
 
-  void OnAckOfAck(const AckOfAckDatagram& ack_of_ack_dgr) {
+  void OnAckOfAck(const AckOfAckView& ack_of_ack_dgr) {
     auto& packet_seq_gen = p_session_->packet_seq_gen;
     AckSequenceNumber ack_seq_num = ack_of_ack_dgr.header().additional_info();
     PacketSequenceNumber packet_seq_num(0);
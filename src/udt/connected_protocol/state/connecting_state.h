@@ -143,8 +143,8 @@ class ConnectingState
   ConnectingState(typename SocketSession::Ptr p_session)
       : BaseState<Protocol>(),
         p_session_(p_session),
-        send_timer_(p_session_->get_io_service()),
-        timeout_timer_(p_session_->get_io_service()),
+        send_timer_(p_session_->get_protocol_io_service()),
+        timeout_timer_(p_session_->get_protocol_io_service()),
         stop_sending_(false) {}
 
   void Connect() {
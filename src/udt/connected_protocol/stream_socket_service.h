@@ -187,9 +187,8 @@ class stream_socket_service : public boost::asio::detail::service_base<
 
     boost::system::error_code ec;
     p_multiplexer_type p_multiplexer =
-        protocol_type::multiplexers_manager_.CreateMultiplexer(
-            this->get_io_service(),
-            typename protocol_type::next_layer_protocol::endpoint(), ec);
+        protocol_type::multiplexers_manager_.GetClientMultiplexer(
+            this->get_io_service(), ec);
 
     if (ec) {
       this->get_io_service().post(boost::asio::detail::binder1<
@@ -231,6 +230,19 @@ class stream_socket_service : public boost::asio::detail::service_base<
     if (option.name(protocol_type::v4()) == protocol_type::TIMEOUT_DELAY) {
       boost::recursive_mutex::scoped_lock lock(impl->mutex);
       impl->timeout_delay = option.value();
+    } else if (option.name(protocol_type::v4()) ==
+               protocol_type::SEND_WEIGHT) {
+      if (option.value() <= 0) {
+        ec.assign(::common::error::invalid_argument,
+                  ::common::error::get_error_category());
+        return ec;
+      }
+      impl->send_weight = static_cast<uint32_t>(option.value());
+    } else if (option.name(protocol_type::v4()) ==
+               protocol_type::SEND_PRIORITY) {
+      impl->send_priority = static_cast<bool>(option.value());
+    } else if (option.name(protocol_type::v4()) == protocol_type::SEND_COPY) {
+      impl->send_copy = static_cast<bool>(option.value());
     }
 
     return ec;
@@ -0,0 +1,109 @@
+#ifndef UDT_CONNECTED_PROTOCOL_TIMER_POOL_H_
+#define UDT_CONNECTED_PROTOCOL_TIMER_POOL_H_
+
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/thread/thread.hpp>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif  // defined(__linux__)
+
+namespace connected_protocol {
+
+/// Threads running the pacing and protocol timers of every multiplexer
+/**
+* One io_service per thread : the handlers of an io_service never run
+* concurrently. Flows and sessions are given io_services in turn to spread
+* them across threads.
+*/
+class TimerPool {
+ public:
+  typedef std::shared_ptr<TimerPool> Ptr;
+
+ public:
+  /**
+  * @param threads_count Number of threads (at least 1)
+  * @param cpus Thread i is pinned to cpus[i % cpus.size()], no pinning if
+  *   empty (Linux only)
+  */
+  static Ptr Create(uint32_t threads_count,
+                    const std::vector<uint32_t> &cpus = std::vector<uint32_t>()) {
+    return Ptr(new TimerPool(threads_count, cpus));
+  }
+
+  ~TimerPool() {
+    for (auto &p_io_service : io_services_) {
+      p_io_service->stop();
+    }
+    threads_.join_all();
+  }
+
+  /// Next io_service in round robin
+  boost::asio::io_service &NextIoService() {
+    return *io_services_[next_.fetch_add(1) % io_services_.size()];
+  }
+
+  /// io_service of thread index % size()
+  boost::asio::io_service &io_service(std::size_t index) {
+    return *io_services_[index % io_services_.size()];
+  }
+
+  std::size_t size() const { return io_services_.size(); }
+
+ private:
+  TimerPool(uint32_t threads_count, const std::vector<uint32_t> &cpus)
+      : io_services_(), workers_(), threads_(), next_(0) {
+    if (threads_count == 0) {
+      threads_count = 1;
+    }
+
+    for (uint32_t i = 0; i < threads_count; ++i) {
+      io_services_.emplace_back(new boost::asio::io_service());
+      workers_.emplace_back(
+          new boost::asio::io_service::work(*io_services_.back()));
+    }
+
+    for (uint32_t i = 0; i < threads_count; ++i) {
+      boost::asio::io_service &io_service = *io_services_[i];
+      boost::thread *p_thread(
+          threads_.create_thread([&io_service]() { io_service.run(); }));
+      if (!cpus.empty()) {
+        PinThread(p_thread, cpus[i % cpus.size()]);
+      }
+    }
+  }
+
+  static void PinThread(boost::thread *p_thread, uint32_t cpu) {
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    if (::pthread_setaffinity_np(p_thread->native_handle(), sizeof(cpu_set),
+                                 &cpu_set) != 0) {
+      BOOST_LOG_TRIVIAL(trace) << "Timer pool : could not pin thread on cpu "
+                               << cpu;
+    }
+#else
+    (void)p_thread;
+    BOOST_LOG_TRIVIAL(trace) << "Timer pool : thread pinning not supported";
+#endif  // defined(__linux__)
+  }
+
+ private:
+  std::vector<std::unique_ptr<boost::asio::io_service>> io_services_;
+  std::vector<std::unique_ptr<boost::asio::io_service::work>> workers_;
+  boost::thread_group threads_;
+  std::atomic<uint32_t> next_;
+};
+
+}  // connected_protocol
+
+#endif  // UDT_CONNECTED_PROTOCOL_TIMER_POOL_H_